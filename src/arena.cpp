@@ -0,0 +1,89 @@
+// arena.cpp
+
+#include "arena.hpp"
+#include "errors.hpp"
+
+#include <new>
+
+
+
+namespace MDDL {
+
+static constexpr size_t ARENA_ALIGN = alignof( std::max_align_t );
+
+// one per runtime. an arena that finds no slot gets no space
+// and every allocation falls back to the pool
+static constexpr int MAX_ARENAS = 16;
+static std::atomic<Arena*> arenas[MAX_ARENAS] = {};
+
+thread_local Arena* Arena::local = nullptr;
+
+Arena::Arena( size_t capacity )
+{
+    begin = (char* )::operator new( capacity );
+    end = begin + capacity;
+    top = begin;
+
+    // published only once its range is set, owner() may look from any thread
+    for ( std::atomic<Arena*>& slot : arenas ) {
+        Arena* empty = nullptr;
+        if ( slot.compare_exchange_strong( empty, this, std::memory_order_acq_rel ) )
+            return;
+    }
+
+    ::operator delete( begin );
+    begin = end = top = nullptr;
+}
+
+Arena::~Arena()
+{
+    for ( std::atomic<Arena*>& slot : arenas ) {
+        Arena* self = this;
+        if ( slot.compare_exchange_strong( self, nullptr, std::memory_order_acq_rel ) )
+            break;
+    }
+
+    ::operator delete( begin );
+}
+
+Arena* Arena::owner( const void* p )
+{
+    for ( const std::atomic<Arena*>& slot : arenas ) {
+        Arena* arena = slot.load( std::memory_order_acquire );
+        if ( arena != nullptr && arena->owns( p ) )
+            return arena;
+    }
+
+    return nullptr;
+}
+
+void* Arena::alloc( size_t size )
+{
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if ( (size_t )(end - top) < size )
+        return nullptr;
+
+    void* p = top;
+    top += size;
+    live.fetch_add( 1, std::memory_order_relaxed );
+    return p;
+}
+
+void Arena::free( [[maybe_unused]] void* p )
+{
+    live.fetch_sub( 1, std::memory_order_release );
+}
+
+void Arena::rewind()
+{
+    if ( live.load( std::memory_order_acquire ) == 0 )
+        top = begin;
+}
+
+void Arena::reset()
+{
+    sys_assert( live.load( std::memory_order_acquire ) == 0, "Arena reset with live blocks." );
+    top = begin;
+}
+
+} // namespace MDDL
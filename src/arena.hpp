@@ -0,0 +1,68 @@
+// arena.hpp
+// Bump allocator for the temporaries of a root evaluation.
+// Space is reclaimed once every block is freed, the runtime moves what
+// outlives a root to the pool first.
+
+#ifndef __MDDL_ARENA_HPP__
+#define __MDDL_ARENA_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+
+namespace MDDL {
+
+class Arena
+{
+public:
+    Arena( size_t capacity );
+    ~Arena();
+
+    Arena( const Arena& ) = delete;
+    Arena& operator=( const Arena& ) = delete;
+
+    // nullptr when full
+    void* alloc( size_t size );
+    // any thread, the space is only rewound by the owning thread
+    void free( void* p );
+    void rewind();
+    // every block must have been freed
+    void reset();
+    bool owns( const void* p ) const { return p >= begin && p < end; }
+
+    // the arena p lies in, by address range, nullptr for other memory
+    static Arena* owner( const void* p );
+
+    // arena of this thread, allocated from while enabled
+    static thread_local Arena* local;
+
+    bool        enabled     = false;
+
+private:
+    char*       begin       = nullptr;
+    char*       end         = nullptr;
+    char*       top         = nullptr;
+    std::atomic<int64_t> live = 0;
+};
+
+// allocates temporaries from arena while in scope
+struct ArenaScope
+{
+    ArenaScope( Arena& arena )
+        : arena { arena }
+    {
+        Arena::local = &arena;
+        arena.rewind();
+        arena.enabled = true;
+    }
+
+    ~ArenaScope() { arena.enabled = false; }
+
+    Arena&      arena;
+};
+
+} // namespace MDDL
+
+#endif // __MDDL_ARENA_HPP__
@@ -0,0 +1,180 @@
+// bytecode.cpp
+
+#include "bytecode.hpp"
+#include "environment.hpp"
+#include "errors.hpp"
+
+#include <iostream>
+
+
+
+namespace MDDL {
+
+Bytecode::Bytecode( const Scope* scope )
+    : tail      { scope->tail }
+    , tail_expr { scope->tail == nullptr ? nullptr : scope->tail->expr }
+{
+    // a failed root is only ever left at the tail, it ends the code
+    const ExprRoot* root = scope->head;
+    for ( ; root != nullptr && root->expr != nullptr; root = root->next ) {
+        roots[root] = (int32_t )instrs.size();
+        compile_root( root );
+    }
+
+    const int32_t end = (int32_t )instrs.size();
+    roots[root] = end;
+
+    Instr in;
+    in.code = Instr::END;
+    emit( in );
+
+    // branch targets outside the code (null or past a failed root) end it
+    const auto offset = [&]( const ExprRoot* target ) {
+        const auto it = roots.find( target );
+        return (it == roots.end()) ? end : it->second;
+    };
+
+    for ( const auto& [i, br_expr] : branches ) {
+        instrs[i].target = offset( instrs[i].code == Instr::JUMP ? br_expr->branch_down : br_expr->branch_up );
+        instrs[i].alt = offset( br_expr->branch_down );
+    }
+
+    branches.clear();
+    mark_tail_calls();
+}
+
+int32_t Bytecode::entry( const ExprRoot* root ) const
+{
+    const auto it = roots.find( root );
+    sys_assert( it != roots.end(), "Root is not in compiled scope." );
+    return it->second;
+}
+
+bool Bytecode::current( const Scope* scope ) const
+{
+    return tail == scope->tail && tail_expr == (scope->tail == nullptr ? nullptr : scope->tail->expr);
+}
+
+void Bytecode::compile_root( const ExprRoot* root )
+{
+    Instr in;
+
+    if ( !root->is_branch() ) {
+        in.code = Instr::RELEASE;
+        emit( in );
+        compile_expr( root->expr );
+        in.code = Instr::HOLD;
+        emit( in );
+        return;
+    }
+
+    const BranchExpr* br_expr = dynamic_cast<const BranchExpr*>( root->expr );
+    if ( br_expr->child == nullptr ) {
+        in.code = Instr::JUMP;
+    } else {
+        compile_expr( br_expr->child );
+        in.code = Instr::BRANCH;
+    }
+
+    branches.push_back( { (int32_t )instrs.size(), br_expr } );
+    emit( in );
+}
+
+void Bytecode::compile_expr( const Expr* expr )
+{
+    Instr in;
+
+    switch ( expr->expr_type ) {
+        case ExprType::FUNCTION_CALL: {
+            const FunctionCallExpr* fn_expr = dynamic_cast<const FunctionCallExpr*>( expr );
+            for ( const Expr* child : fn_expr->children ) {
+                compile_expr( child );
+                in.code = Instr::CAST_SEQ;
+                emit( in );
+            }
+
+            in.code = Instr::CALL;
+            in.fn_expr = fn_expr;
+            break;
+        }
+        case ExprType::OPERATION: {
+            const OperationExpr* op_expr = dynamic_cast<const OperationExpr*>( expr );
+            compile_expr( op_expr->child_lhs );
+            if ( op_expr->child_rhs != nullptr ) {
+                compile_expr( op_expr->child_rhs );
+            } else {
+                in.code = Instr::PUSH_TYPE;
+                in.type = DataType::NONE;
+                emit( in );
+            }
+
+            in.code = Instr::OP;
+            in.op_expr = op_expr;
+            break;
+        }
+        case ExprType::VARIABLE:
+            in.code = Instr::LOAD_VAR;
+            in.var_expr = dynamic_cast<const VariableExpr*>( expr );
+            break;
+        case ExprType::VALUE_LITERAL:
+            in.code = Instr::PUSH_VALUE;
+            in.value = dynamic_cast<const ValueLiteralExpr*>( expr )->value;
+            break;
+        case ExprType::SEQUENCE_LITERAL:
+            in.code = Instr::PUSH_SEQ_LIT;
+            in.seq_expr = dynamic_cast<const SequenceLiteralExpr*>( expr );
+            break;
+        default:
+            in.code = Instr::PUSH_TYPE;
+            in.type = DataType::ERROR;
+            break;
+    }
+
+    emit( in );
+}
+
+// a call held as the result of the last root, or of a root that only jumps to the end
+void Bytecode::mark_tail_calls()
+{
+    for ( int32_t i = 0; i + 1 < (int32_t )instrs.size(); i ++ ) {
+        if ( instrs[i].code != Instr::CALL || instrs[i + 1].code != Instr::HOLD )
+            continue;
+
+        // jumps only ever go down
+        int32_t next = i + 2;
+        while ( instrs[next].code == Instr::JUMP )
+            next = instrs[next].target;
+
+        if ( instrs[next].code == Instr::END )
+            instrs[i].code = Instr::TAIL_CALL;
+    }
+}
+
+void Bytecode::print() const
+{
+    static const char* NAMES[] = {
+        "PUSH_VALUE", "PUSH_TYPE", "PUSH_SEQ_LIT", "LOAD_VAR", "CAST_SEQ",
+        "OP", "CALL", "TAIL_CALL", "RELEASE", "HOLD", "JUMP", "BRANCH", "END"
+    };
+
+    for ( int i = 0; i < (int )instrs.size(); i ++ ) {
+        const Instr& in = instrs[i];
+        std::cout << i << ": " << NAMES[in.code];
+
+        switch ( in.code ) {
+            case Instr::PUSH_VALUE: std::cout << " " << in.value; break;
+            case Instr::PUSH_TYPE: std::cout << " " << dt_to_string( in.type ); break;
+            case Instr::LOAD_VAR: std::cout << " " << in.var_expr->stack_offset; break;
+            case Instr::OP: std::cout << " " << in.op_expr->name; break;
+            case Instr::CALL:
+            case Instr::TAIL_CALL: std::cout << " " << in.fn_expr->to_string(); break;
+            case Instr::JUMP: std::cout << " " << in.target; break;
+            case Instr::BRANCH: std::cout << " " << in.target << " " << in.alt; break;
+            default: break;
+        }
+
+        std::cout << "\n";
+    }
+}
+
+} // namespace MDDL
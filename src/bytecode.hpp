@@ -0,0 +1,85 @@
+// bytecode.hpp
+// Flat stack code compiled from the ExprRoot list of a scope.
+// Operands are evaluated onto an operand stack in postorder,
+// branches jump to the resolved code offsets of their target roots.
+
+#ifndef __MDDL_BYTECODE_HPP__
+#define __MDDL_BYTECODE_HPP__
+
+#include "expr.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+
+namespace MDDL {
+
+class Scope;
+
+struct Instr
+{
+    enum Code : uint8_t
+    {
+        PUSH_VALUE,     // value
+        PUSH_TYPE,      // an empty ref of type, NONE for a missing rhs
+        PUSH_SEQ_LIT,   // seq_expr
+        LOAD_VAR,       // var_expr
+        CAST_SEQ,       // function argument on top
+        OP,             // op_expr, pops rhs then lhs
+        CALL,           // fn_expr, pops one argument per child
+        TAIL_CALL,      // a CALL whose result is returned, the callee takes over the frame
+        RELEASE,        // drops the held value, ahead of the next root
+        HOLD,           // pops the value of a root, held as the scope's result
+        JUMP,           // to target
+        BRANCH,         // pops a VALUE, to target if > 0 else to alt
+        END,            // returns the held value
+    };
+
+    Code            code        = END;
+    DataType        type        = DataType::UNKNOWN;
+    int32_t         target      = 0;
+    int32_t         alt         = 0;
+    union {
+        int64_t                     value       = 0;
+        const OperationExpr*        op_expr;
+        const FunctionCallExpr*     fn_expr;
+        const VariableExpr*         var_expr;
+        const SequenceLiteralExpr*  seq_expr;
+    };
+};
+
+struct Bytecode
+{
+    Bytecode( const Scope* scope );
+
+    // code offset of a root of the scope
+    int32_t entry( const ExprRoot* root ) const;
+
+    // compiled against this tail, roots are only ever appended or replaced at the tail
+    bool current( const Scope* scope ) const;
+
+    void print() const;
+
+    std::vector<Instr>  instrs      = {};
+    std::unordered_map<const ExprRoot*, int32_t>
+                        roots       = {};
+    const ExprRoot*     tail        = nullptr;
+    const Expr*         tail_expr   = nullptr;
+
+private:
+    void compile_root( const ExprRoot* root );
+    void compile_expr( const Expr* expr );
+    void mark_tail_calls();
+    void emit( const Instr& instr ) { instrs.push_back( instr ); }
+
+    // jumps to resolve once every root has its offset
+    std::vector<std::pair<int32_t, const BranchExpr*>>
+                        branches    = {};
+};
+
+} // namespace MDDL
+
+#endif // __MDDL_BYTECODE_HPP__
@@ -26,6 +26,7 @@ enum OpId : int
     IEF_PRINTD      = 0x26,
     IEF_RECORDING   = 0x27,
     IEF_RANDOM      = 0x28,
+    IEF_STATS       = 0x29,
 };
 
 } // namespace MDDL
@@ -12,16 +12,28 @@ DataRef::DataRef( DataType type )
 {}
 
 DataRef::DataRef( int64_t value )
-    : type  { DataType::VALUE }
-    , value { value }
+    : value { value }
+    , type  { DataType::VALUE }
 {}
 
 DataRef::DataRef( DataType type, Sequence* seq, AttrType attr )
-    : type  { type }
+    : ref   { seq }
+    , type  { type }
     , attr  { attr }
-    , ref   { seq }
 {
-    seq->ref_count ++;
+    seq->ref_count.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void DataRef::set_range( int64_t r_start, int64_t r_size )
+{
+    range_start = r_start;
+    range_size = r_size;
+}
+
+void DataRef::clear_range()
+{
+    range_start = 0;
+    range_size = 0;
 }
 
 void DataRef::attach( Sequence* seq, int64_t ref_start, int64_t ref_size )
@@ -29,27 +41,33 @@ void DataRef::attach( Sequence* seq, int64_t ref_start, int64_t ref_size )
     sys_assert( seq != nullptr );
 
     ref = seq;
-    seq->ref_count ++;
-
-    start = ref_start;
-    size = ref_size;
+    seq->ref_count.fetch_add( 1, std::memory_order_relaxed );
+    set_range( ref_start, ref_size );
 }
 
 void DataRef::release()
 {
-    if ( ref == nullptr )
+    Sequence* seq = get_ref();
+    clear_range();
+
+    if ( seq == nullptr )
         return;
 
-    ref->ref_count --;
-    if ( ref->ref_count == 0 )
-        delete ref;
-        
     ref = nullptr;
+    if ( seq->ref_count.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+        delete seq;
 }
 
+// takes over the count held by rhs, in place of the ref held here
 void DataRef::take( DataRef&& rhs )
 {
-    attach( rhs.ref, rhs.start, rhs.size );
+    release();
+    ref = rhs.get_ref();
+    range_start = rhs.range_start;
+    range_size = rhs.range_size;
+
+    rhs.ref = nullptr;
+    rhs.clear_range();
 } 
 
 void DataRef::implicit_cast( DataType t )
@@ -58,37 +76,41 @@ void DataRef::implicit_cast( DataType t )
     type = t;
 }
 
+// shares chunks with ref, writes to either side copy them (see sequence.cpp)
 [[nodiscard]] DataRef DataRef::copy() const
 {
-    sys_assert( ref != nullptr );
-    return DataRef( type, new Sequence( get(), start, length() ), attr );
+    sys_assert( get_ref() != nullptr );
+    return DataRef( type, new Sequence( get(), start(), length() ), attr );
 }
 
 [[nodiscard]] DataRef DataRef::duplicate() const
 {
-    sys_assert( ref != nullptr );
-    ref->ref_count ++;
+    sys_assert( get_ref() != nullptr );
+    get_ref()->ref_count.fetch_add( 1, std::memory_order_relaxed );
+
     return *this;
 }
 
 [[nodiscard]] DataRef DataRef::move()
 {
-    sys_assert( ref != nullptr );
+    sys_assert( !empty() );
     DataRef x = *this;
     ref = nullptr;
+    clear_range();
     return x;
 }
 
 // moves if exclusively owned,  
 [[nodiscard]] DataRef DataRef::elide_copy()
 {
-    sys_assert( ref != nullptr );
+    sys_assert( get_ref() != nullptr );
     type = to_copy_type( type );
 
-    if ( ref->ref_count == 1 ) {
+    if ( get_ref()->ref_count.load( std::memory_order_acquire ) == 1 ) {
         // ref is going to be destructed, move instead
         if ( is_subseq() )
-            ref->crop( start, size );
+            get_ref()->crop( start(), size() );
+        clear_range();
         return move();
     }
 
@@ -111,7 +133,7 @@ void DataRef::implicit_cast( DataType t )
         case DataType::ATTR:
         case DataType::VATTR:
             v = elide_copy();
-            v.ref->mask( attr );
+            v.get().mask( attr );
             v.type = DataType::VSEQ;
             return v;
         case DataType::SEQ:
@@ -137,7 +159,7 @@ void DataRef::implicit_cast( DataType t )
         case DataType::ATTR:
         case DataType::VATTR:
             v = elide_copy();
-            v.ref->mask( attr );
+            v.get().mask( attr );
             v.type = DataType::SEQ;
             return v;
         case DataType::SEQ:
@@ -165,18 +187,19 @@ void DataRef::print()
     if ( stack_pos != -1 )
         std::cout << ", Stack: " << stack_pos;
 
-    std::cout << ", Ref: " << ref;
+    std::cout << ", Ref: " << get_ref();
     
 
-    if ( ref != nullptr ) {
-        std::cout << ", Ref Count: " << ref->ref_count;
+    if ( get_ref() != nullptr ) {
+        std::cout << ", Ref Count: " << get_ref()->ref_count.load();
         std::cout << ", Len: " << length();
     }
     
     if ( is_subseq() )
-        std::cout << " (" << start << ", " << start + size << ")";
+        std::cout << " (" << start() << ", " << start() + size() << ")";
 
-    std::cout << ", Val: " << value;
+    if ( type == DataType::VALUE )
+        std::cout << ", Val: " << value;
     std::cout << "]\n";
 }
 
@@ -8,6 +8,9 @@
 
 namespace MDDL {
 
+// 32 bytes: a VALUE is held in place of the pointer,
+// a subsequence range (or an INDEXER) is held inline.
+// trivially copyable, a copy owns nothing until duplicate() counts it
 struct DataRef
 {
     DataRef() = default;
@@ -15,9 +18,15 @@ struct DataRef
     DataRef( DataType type );
     DataRef( DataType type, Sequence* seq, AttrType attr = AttrType::ALL );
 
-    bool is_subseq() const { return size != 0; }
-    int64_t length() const { return is_subseq() ? size : ref->size; }
-    bool empty() const { return ref == nullptr; }
+    Sequence* get_ref() const { return (type == DataType::VALUE) ? nullptr : ref; }
+    int64_t start() const { return range_start; }
+    int64_t size() const { return range_size; }
+    void set_range( int64_t r_start, int64_t r_size );
+    void clear_range();
+
+    bool is_subseq() const { return size() != 0; }
+    int64_t length() const { return is_subseq() ? size() : get_ref()->size; }
+    bool empty() const { return get_ref() == nullptr; }
     bool is_ref_type() const { return type == DataType::SEQ || type == DataType::ATTR; }
     bool is_copy_type() const { return type == DataType::VSEQ || type == DataType::VATTR; }
     
@@ -25,12 +34,10 @@ struct DataRef
     void release();
     void take( DataRef&& ref );
 
-    std::mutex& mtx() { return ref->mtx; }
-
     void implicit_cast( DataType t );
 
-    [[nodiscard]] const Sequence& get() const { return *ref; }
-    [[nodiscard]] Sequence& get() { return *ref; }
+    [[nodiscard]] const Sequence& get() const { return *get_ref(); }
+    [[nodiscard]] Sequence& get() { return *get_ref(); }
     [[nodiscard]] DataRef copy() const;
     [[nodiscard]] DataRef duplicate() const;
     [[nodiscard]] DataRef move();
@@ -40,15 +47,19 @@ struct DataRef
     
     void print();
 
+    union {
+        Sequence*   ref         = nullptr;
+        int64_t     value;      // when VALUE
+    };
+    int64_t     range_start = 0;
+    int64_t     range_size  = 0;
     DataType    type        = DataType::UNKNOWN;
     AttrType    attr        = AttrType::ALL;
-    Sequence*   ref         = nullptr;
-    int64_t     stack_pos   = -1;
-    int64_t     start       = 0;
-    int64_t     size        = 0;
-    int64_t     value       = 0;
+    int32_t     stack_pos   = -1;
 };
 
+static_assert( sizeof( DataRef ) == 32 );
+
 
 inline bool validate_type( const DataRef& ref, DataType type )
 {
@@ -1,10 +1,13 @@
 // environment.cpp
 
+#include "bytecode.hpp"
 #include "environment.hpp"
 #include "errors.hpp"
+#include "recording.hpp"
 
 #include <cassert>
 #include <iostream>
+#include <unordered_map>
 
 
 namespace MDDL {
@@ -31,6 +34,7 @@ Scope::~Scope()
     for ( Scope* child : children )
         delete child;
         
+    delete code;
     delete head;
 }
 
@@ -62,6 +66,9 @@ void Scope::complete_signature()
 void Scope::complete_body()
 {
     resolve_branch_links();
+    fold_constants();
+    resolve_last_uses();
+    frame_size = (int )vars.size();
 
     stage = Stage::DEFINED;
 }
@@ -200,6 +207,43 @@ static OpId op_note_to_id( uint8_t note, uint8_t root_note, OpId ief_code )
         ? ief_code : note_to_op_id( note, root_note );
 }
 
+// attrs of attr operands are known at build time unless they come through an indexed VATTR,
+// ops on known attrs are bound to the instantiation for them in place of the run time dispatch
+static void infer_attrs( OperationExpr* op_expr )
+{
+    if ( op_expr->fn == nullptr )
+        return;
+
+    const AttrType lhs_attr = is_attr_type( op_expr->lhs_type )
+        ? op_expr->child_lhs->attr : AttrType::ALL;
+    const AttrType rhs_attr = (op_expr->child_rhs != nullptr && is_attr_type( op_expr->rhs_type ))
+        ? op_expr->child_rhs->attr : AttrType::ALL;
+
+    if ( op_expr->attr_fns != nullptr ) {
+        const OpFn fn = op_expr->attr_fns->fns[(int )lhs_attr][(int )rhs_attr];
+        if ( fn != nullptr )
+            op_expr->fn = fn;
+    }
+
+    if ( !is_attr_type( op_expr->return_type ) )
+        return;
+
+    if ( is_attr_type( op_expr->lhs_type ) ) {
+        op_expr->attr = lhs_attr;
+    } else if ( op_expr->rhs_type == DataType::NONE ) {
+        switch ( op_expr->group ) {
+            case OP_FA: op_expr->attr = AttrType::PITCH; break;
+            case OP_SO: op_expr->attr = AttrType::VELOCITY; break;
+            case OP_LA: op_expr->attr = AttrType::DURATION; break;
+            case OP_TI: op_expr->attr = AttrType::WAIT; break;
+            default: break;
+        }
+    } else if ( op_expr->lhs_type == DataType::INDEXER || op_expr->rhs_type == DataType::ATTR ) {
+        // an element indexed out of a VATTR is a new sequence, without the attr
+        op_expr->attr = rhs_attr;
+    }
+}
+
 OperationExpr* Scope::build_operation( const AST::Node* ast, bool leftmost, OpId force_op )
 {
 
@@ -245,6 +289,7 @@ OperationExpr* Scope::build_operation( const AST::Node* ast, bool leftmost, OpId
         // unary operation
         op_expr->rhs_type = DataType::NONE;
         op_expr->query_book( force_copy );
+        infer_attrs( op_expr );
         sys_assert( op_expr->child_rhs == nullptr );
         return op_expr;
     }
@@ -261,6 +306,7 @@ OperationExpr* Scope::build_operation( const AST::Node* ast, bool leftmost, OpId
 
     op_expr->rhs_type = op_expr->child_rhs->return_type;
     op_expr->query_book( force_copy );
+    infer_attrs( op_expr );
 
     rhs = rhs->sibling;
     while ( rhs != nullptr ) {
@@ -281,6 +327,7 @@ OperationExpr* Scope::build_operation( const AST::Node* ast, bool leftmost, OpId
         new_expr->lhs_type = new_expr->child_lhs->return_type;
         new_expr->rhs_type = new_expr->child_rhs->return_type;
         new_expr->query_book( force_copy );
+        infer_attrs( new_expr );
 
         op_expr->parent = new_expr;
         op_expr = new_expr;
@@ -355,6 +402,7 @@ SequenceLiteralExpr* Scope::build_sequence_literal( const AST::Node* ast )
     }
 
     Sequence* seq = new Sequence;
+    seq->rec = new Recording;
     seq->complete = false;
     seq_expr->ref = DataRef( DataType::SEQ_LIT, seq );
 
@@ -416,6 +464,377 @@ void Scope::resolve_branch_links()
     }
 }
 
+// a variable read, or a whole reassignment of the variable
+struct VarEvent
+{
+    VariableExpr*   var         = nullptr;
+    bool            def         = false;
+};
+
+// only a SEQ rhs rebinds the variable outright, a VSEQ rhs writes through
+// a subsequence held by the variable, so the variable is read there
+static bool is_reassignment( const OperationExpr* op_expr )
+{
+    return op_expr->group == OP_DO
+        && op_expr->child_lhs->expr_type == ExprType::VARIABLE
+        && op_expr->lhs_type == DataType::SEQ
+        && op_expr->rhs_type == DataType::SEQ;
+}
+
+// in evaluation order
+static void collect_var_events( Expr* expr, std::vector<VarEvent>& events )
+{
+    if ( expr == nullptr )
+        return;
+
+    switch ( expr->expr_type ) {
+        case ExprType::OPERATION: {
+            OperationExpr* op_expr = dynamic_cast<OperationExpr*>( expr );
+            if ( is_reassignment( op_expr ) ) {
+                // the target is only located, not read
+                collect_var_events( op_expr->child_rhs, events );
+                events.push_back( { dynamic_cast<VariableExpr*>( op_expr->child_lhs ), true } );
+                break;
+            }
+
+            collect_var_events( op_expr->child_lhs, events );
+            collect_var_events( op_expr->child_rhs, events );
+            break;
+        }
+        case ExprType::BRANCH:
+            collect_var_events( dynamic_cast<BranchExpr*>( expr )->child, events );
+            break;
+        case ExprType::FUNCTION_CALL:
+            for ( Expr* child : dynamic_cast<FunctionCallExpr*>( expr )->children )
+                collect_var_events( child, events );
+            break;
+        case ExprType::VARIABLE:
+            events.push_back( { dynamic_cast<VariableExpr*>( expr ), false } );
+            break;
+        default: break;
+    }
+}
+
+// backwards liveness over the roots, once the body is complete.
+// reads after which a variable is dead until the scope exits or reassigns it
+// are marked last_use
+void Scope::resolve_last_uses()
+{
+    std::vector<ExprRoot*> roots;
+    std::unordered_map<const ExprRoot*, int> root_idx;
+    for ( ExprRoot* node = head; node != nullptr && node->expr != nullptr; node = node->next ) {
+        root_idx[node] = (int )roots.size();
+        roots.push_back( node );
+    }
+
+    const int n = (int )roots.size();
+    std::vector<std::vector<VarEvent>> events( n );
+    std::vector<std::vector<int>> succs( n );
+
+    const auto add_succ = [&]( int i, const ExprRoot* node ) {
+        const auto itr = root_idx.find( node );
+        if ( itr != root_idx.end() )
+            succs[i].push_back( itr->second );
+    };
+
+    for ( int i = 0; i < n; i ++ ) {
+        collect_var_events( roots[i]->expr, events[i] );
+
+        if ( !roots[i]->is_branch() ) {
+            add_succ( i, roots[i]->next );
+            continue;
+        }
+
+        const BranchExpr* br_expr = dynamic_cast<const BranchExpr*>( roots[i]->expr );
+        if ( br_expr->child != nullptr )
+            add_succ( i, br_expr->branch_up );
+        add_succ( i, br_expr->branch_down );
+    }
+
+    typedef std::vector<bool> Live;
+    std::vector<Live> live_in( n, Live( vars.size(), false ) );
+
+    const auto transfer = [&]( int i, bool mark ) {
+        Live live( vars.size(), false );
+        for ( int s : succs[i] )
+            for ( size_t v = 0; v < vars.size(); v ++ )
+                live[v] = live[v] || live_in[s][v];
+
+        for ( auto itr = events[i].rbegin(); itr != events[i].rend(); itr ++ ) {
+            const int slot = itr->var->stack_offset;
+            if ( itr->def ) {
+                live[slot] = false;
+                continue;
+            }
+
+            if ( mark )
+                itr->var->last_use = !live[slot];
+            live[slot] = true;
+        }
+
+        return live;
+    };
+
+    bool changed = true;
+    while ( changed ) {
+        changed = false;
+        for ( int i = n - 1; i >= 0; i -- ) {
+            Live live = transfer( i, false );
+            if ( live != live_in[i] ) {
+                live_in[i] = std::move( live );
+                changed = true;
+            }
+        }
+    }
+
+    for ( int i = 0; i < n; i ++ )
+        transfer( i, true );
+}
+
+// literals, and the sequences folded from them
+static bool is_constant( const Expr* expr )
+{
+    return expr->expr_type == ExprType::VALUE_LITERAL
+        || (expr->expr_type == ExprType::SEQUENCE_LITERAL && expr->return_type == DataType::VSEQ);
+}
+
+static DataRef constant_ref( const Expr* expr )
+{
+    if ( expr->expr_type == ExprType::VALUE_LITERAL )
+        return dynamic_cast<const ValueLiteralExpr*>( expr )->value;
+    return dynamic_cast<const SequenceLiteralExpr*>( expr )->ref.duplicate();
+}
+
+static Expr* make_constant( DataRef& v )
+{
+    if ( v.type == DataType::VALUE ) {
+        ValueLiteralExpr* val_expr = new ValueLiteralExpr();
+        val_expr->value = v.value;
+        return val_expr;
+    }
+
+    // held by the expr, every read is a VSEQ copy of it
+    SequenceLiteralExpr* seq_expr = new SequenceLiteralExpr();
+    seq_expr->return_type = DataType::VSEQ;
+    seq_expr->ref = v.move();
+    return seq_expr;
+}
+
+static bool is_value_or_vseq( DataType type )
+{
+    return type == DataType::VALUE || type == DataType::VSEQ;
+}
+
+// a zero divisor faults, which is left to happen at run time
+static bool may_divide_by_zero( const OperationExpr* op_expr )
+{
+    if ( op_expr->group != OP_TI || op_expr->child_rhs == nullptr )
+        return false;
+
+    return op_expr->child_rhs->expr_type != ExprType::VALUE_LITERAL
+        || dynamic_cast<const ValueLiteralExpr*>( op_expr->child_rhs )->value == 0;
+}
+
+// ops on VALUE and VSEQ copies don't touch the runtime or any variable,
+// they can be evaluated as soon as their operands are constants
+static bool is_foldable( const OperationExpr* op_expr )
+{
+    return op_expr->group >= OP_DO && op_expr->group <= OP_TI
+        && op_expr->fn != nullptr
+        && !may_divide_by_zero( op_expr )
+        && is_value_or_vseq( op_expr->lhs_type )
+        && (is_value_or_vseq( op_expr->rhs_type ) || op_expr->rhs_type == DataType::NONE)
+        && is_value_or_vseq( op_expr->return_type )
+        && is_constant( op_expr->child_lhs )
+        && (op_expr->child_rhs == nullptr || is_constant( op_expr->child_rhs ));
+}
+
+// returns the expr to take the place of expr, which is deleted if replaced
+static Expr* fold_expr( Expr* expr )
+{
+    switch ( expr->expr_type ) {
+        case ExprType::FUNCTION_CALL:
+            for ( Expr*& child : dynamic_cast<FunctionCallExpr*>( expr )->children )
+                child = fold_expr( child );
+            return expr;
+        case ExprType::BRANCH: {
+            // the compare op is kept, its branch is taken at run time
+            OperationExpr* op_expr = dynamic_cast<BranchExpr*>( expr )->child;
+            if ( op_expr != nullptr ) {
+                op_expr->child_lhs = fold_expr( op_expr->child_lhs );
+                if ( op_expr->child_rhs != nullptr )
+                    op_expr->child_rhs = fold_expr( op_expr->child_rhs );
+            }
+            return expr;
+        }
+        case ExprType::OPERATION: break;
+        default: return expr;
+    }
+
+    OperationExpr* op_expr = dynamic_cast<OperationExpr*>( expr );
+    op_expr->child_lhs = fold_expr( op_expr->child_lhs );
+    if ( op_expr->child_rhs != nullptr )
+        op_expr->child_rhs = fold_expr( op_expr->child_rhs );
+
+    if ( !is_foldable( op_expr ) )
+        return expr;
+
+    DataRef lhs = constant_ref( op_expr->child_lhs );
+    DataRef rhs = (op_expr->child_rhs == nullptr) ? DataType::NONE : constant_ref( op_expr->child_rhs );
+    DataRef v;
+
+    try {
+        v = op_expr->fn( nullptr, lhs, rhs );
+    } catch ( const MDDL_RuntimeError& ) {
+        // raised when the op runs instead
+        lhs.release();
+        rhs.release();
+        return expr;
+    }
+
+    Expr* folded = make_constant( v );
+    folded->parent = op_expr->parent;
+    delete op_expr;
+    return folded;
+}
+
+void Scope::fold_root( ExprRoot* root )
+{
+    if ( root != nullptr && root->expr != nullptr )
+        root->expr = fold_expr( root->expr );
+}
+
+// a variable read that can't write through to the variable, the op takes a VSEQ copy
+static bool is_copy_read( const VariableExpr* var_expr )
+{
+    if ( var_expr->parent == nullptr || var_expr->parent->expr_type != ExprType::OPERATION )
+        return false;
+
+    const OperationExpr* op_expr = dynamic_cast<const OperationExpr*>( var_expr->parent );
+    const DataType type = (op_expr->child_lhs == var_expr) ? op_expr->lhs_type : op_expr->rhs_type;
+    return type == DataType::VSEQ;
+}
+
+// replaces the reads of var_expr's slot with copies of constant
+static Expr* propagate_constant( Expr* expr, int slot, const Expr* constant )
+{
+    switch ( expr->expr_type ) {
+        case ExprType::VARIABLE: {
+            if ( dynamic_cast<VariableExpr*>( expr )->stack_offset != slot )
+                return expr;
+
+            DataRef v = constant_ref( constant );
+            Expr* copy = make_constant( v );
+            copy->parent = expr->parent;
+            delete expr;
+            return copy;
+        }
+        case ExprType::OPERATION: {
+            OperationExpr* op_expr = dynamic_cast<OperationExpr*>( expr );
+            op_expr->child_lhs = propagate_constant( op_expr->child_lhs, slot, constant );
+            if ( op_expr->child_rhs != nullptr )
+                op_expr->child_rhs = propagate_constant( op_expr->child_rhs, slot, constant );
+            return expr;
+        }
+        case ExprType::BRANCH: {
+            OperationExpr* op_expr = dynamic_cast<BranchExpr*>( expr )->child;
+            if ( op_expr != nullptr )
+                propagate_constant( op_expr, slot, constant );
+            return expr;
+        }
+        case ExprType::FUNCTION_CALL:
+            for ( Expr*& child : dynamic_cast<FunctionCallExpr*>( expr )->children )
+                child = propagate_constant( child, slot, constant );
+            return expr;
+        default: return expr;
+    }
+}
+
+// a root that sets a whole variable to a constant sequence, the set
+// replaces what the variable holds when it is the variable's first event
+static VariableExpr* constant_def( const ExprRoot* root )
+{
+    if ( root->expr->expr_type != ExprType::OPERATION )
+        return nullptr;
+
+    const OperationExpr* op_expr = dynamic_cast<const OperationExpr*>( root->expr );
+    if ( op_expr->group != OP_DO
+        || op_expr->child_lhs->expr_type != ExprType::VARIABLE
+        || op_expr->lhs_type != DataType::SEQ
+        || op_expr->rhs_type != DataType::VSEQ
+        || !is_constant( op_expr->child_rhs ) )
+        return nullptr;
+
+    return dynamic_cast<VariableExpr*>( op_expr->child_lhs );
+}
+
+// folds literal operations, then propagates variables assigned a constant once
+// ahead of the first branch, when every read of them is a copy, and folds again
+void Scope::fold_constants()
+{
+    std::vector<ExprRoot*> roots;
+    for ( ExprRoot* node = head; node != nullptr && node->expr != nullptr; node = node->next ) {
+        fold_root( node );
+        roots.push_back( node );
+    }
+
+    std::vector<bool> propagated( vars.size(), false );
+
+    bool changed = true;
+    while ( changed ) {
+        changed = false;
+
+        std::vector<int> defs( vars.size(), 0 );
+        std::vector<int> def_root( vars.size(), -1 );
+        std::vector<bool> propagable( vars.size(), true );
+        std::vector<VarEvent> events;
+
+        bool branched = false;
+        for ( int i = 0; i < (int )roots.size(); i ++ ) {
+            branched = branched || roots[i]->is_branch();
+
+            // a VSEQ assignment is a read to the liveness pass, here the constant one is a def
+            VariableExpr* def_var = constant_def( roots[i] );
+            events.clear();
+            if ( def_var != nullptr ) {
+                events.push_back( { def_var, true } );
+            } else {
+                collect_var_events( roots[i]->expr, events );
+            }
+
+            for ( const VarEvent& e : events ) {
+                const int slot = e.var->stack_offset;
+                if ( !e.def ) {
+                    // read ahead of the assignment, or through to the variable
+                    propagable[slot] = propagable[slot] && def_root[slot] != -1 && is_copy_read( e.var );
+                    continue;
+                }
+
+                defs[slot] ++;
+
+                // the assignment of a constant is the whole root, and runs once ahead of every read
+                propagable[slot] = propagable[slot] && !branched && e.var == def_var;
+                def_root[slot] = i;
+            }
+        }
+
+        for ( int slot = (int )args.size(); slot < (int )vars.size(); slot ++ ) {
+            if ( propagated[slot] || defs[slot] != 1 || !propagable[slot] )
+                continue;
+
+            const OperationExpr* def = dynamic_cast<const OperationExpr*>( roots[def_root[slot]]->expr );
+            for ( int i = def_root[slot] + 1; i < (int )roots.size(); i ++ ) {
+                roots[i]->expr = propagate_constant( roots[i]->expr, slot, def->child_rhs );
+                fold_root( roots[i] );
+            }
+
+            // the assignment is kept, the variable holds its value for the scope's result
+            propagated[slot] = true;
+            changed = true;
+        }
+    }
+}
+
 void Scope::resolve_function_links()
 {
     auto itr = unresolved_calls.begin();
@@ -456,6 +875,15 @@ void Scope::print() const
         child->print();
 }
 
+void Scope::print_stats() const
+{
+    std::cout << "\nFN " << symbol_to_str( chord ) << "\n";
+    stats.print( std::cout );
+
+    for ( Scope* child : children )
+        child->print_stats();
+}
+
 
 
 
@@ -484,7 +912,14 @@ bool StaticEnvironment::add_ast( const AST& ast )
 
     // ast.print();
 
-    return tail->add_ast( node );
+    if ( !tail->add_ast( node ) )
+        return false;
+
+    // global roots run as they are committed, nothing is known of later assignments
+    if ( at_global_scope() )
+        global->fold_root( global->tail );
+
+    return true;
 }
 
 void StaticEnvironment::resolve_links()
@@ -511,6 +946,21 @@ void StaticEnvironment::print() const
     std::cout << "--------\n";
 }
 
+void StaticEnvironment::print_stats() const
+{
+    std::cout << "\nMEMORY\n";
+    std::cout << "--------\n";
+    MemStats::global.print( std::cout );
+
+    std::cout << "\nGLOBAL\n";
+    global->stats.print( std::cout );
+
+    for ( Scope* child : global->children )
+        child->print_stats();
+
+    std::cout << "--------\n";
+}
+
 void StaticEnvironment::process_function_def( const Symbol& chord )
 {
     if ( tail->chord == chord ) {
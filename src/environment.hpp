@@ -4,6 +4,7 @@
 #define __MDDL_ENVIRONMENT_HPP__
 
 #include "expr.hpp"
+#include "stats.hpp"
 #include "syntax.hpp"
 #include "utils.hpp"
 
@@ -16,6 +17,8 @@ namespace MDDL {
 
 namespace MIDI = libremidi;
 
+struct Bytecode;
+
 class Scope
 {
 public:
@@ -41,11 +44,17 @@ public:
     Expr* build_expr_root( const AST::Node* ast );
 
     Scope* query_scope( const Symbol& id );
+    int get_frame_size() const { return stage == Stage::DEFINED ? frame_size : (int )vars.size(); }
 
     void resolve_branch_links();
+    void resolve_last_uses();
     void resolve_function_links();
 
+    void fold_constants();
+    void fold_root( ExprRoot* root );
+
     void print() const;
+    void print_stats() const;
 
 private:
     bool add_to_signature( const AST::Node* ast );
@@ -66,6 +75,7 @@ public:
     Stage                   stage               = Stage::SIGNATURE;
     std::vector<Symbol>     args                = {};  
     std::vector<Symbol>     vars                = {};
+    int                     frame_size          = 0;    // stack slots of a call, once defined
     ExprRoot*               head                = nullptr;
     ExprRoot*               tail                = nullptr;
     std::vector<Scope*>     children            = {};
@@ -74,6 +84,8 @@ public:
     std::list<SeqLit*>      slrx_queue          = {};
     OpId                    ief_code            = IEF_DEFAULT;
     bool                    error               = false;
+    mutable MemStats        stats               = {};   // charged while executing
+    mutable Bytecode*       code                = nullptr;  // compiled on first run
 };
 
 class StaticEnvironment
@@ -92,6 +104,7 @@ public:
     void resolve_links();
 
     void print() const;
+    void print_stats() const;
 
     Scope* global   = nullptr;
     Scope* tail     = nullptr;
@@ -80,42 +80,22 @@ void OperationExpr::query_book( bool force_copy )
         rhs_type = to_copy_type( rhs_type );
     }
 
-    OpBookKey key( group, lhs_type, rhs_type );
-    
-    if ( op_book.contains( key ) ) {
-        from_book( key, op_book[key] );
+    const OpBookEntry& entry = op_table.at( group, lhs_type, rhs_type );
+    if ( entry.fn == nullptr ) {
+        error = true;
         return;
     }
 
-    while ( has_implicit_cast( key.rhs_t ) ) {
-        key.rhs_t = implicit_cast( key.rhs_t  );
-
-        if ( op_book.contains( key ) ) {
-            from_book( key, op_book[key] );
-            return;
-        }
-    }
-
-    // key.rhs_t = rhs_type; // return to original type?
-
-    while ( has_implicit_cast( key.lhs_t ) ) {
-        key.lhs_t = implicit_cast( key.lhs_t  );
-
-        if ( op_book.contains( key ) ) {
-            from_book( key, op_book[key] );
-            return;
-        }
-    }
-
-    error = true;
+    from_book( entry );
 }
 
-void OperationExpr::from_book( const OpBookKey& key, const OpBookEntry& entry )
+void OperationExpr::from_book( const OpBookEntry& entry )
 {
-    lhs_type = key.lhs_t;
-    rhs_type = key.rhs_t;
+    lhs_type = entry.lhs_t;
+    rhs_type = entry.rhs_t;
     name = entry.name;
     fn = entry.fn;
+    attr_fns = entry.attr_fns;
     return_type = entry.return_t;
 }
 
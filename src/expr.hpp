@@ -35,6 +35,7 @@ public:
 
     const ExprType  expr_type;
     DataType        return_type = DataType::UNKNOWN;
+    AttrType        attr        = AttrType::ALL;    // of an ATTR/VATTR result, ALL if not known at build time
     Expr*           parent      = nullptr;
     bool            error       = false;
 };
@@ -80,7 +81,7 @@ public:
     std::string to_string() const override;
     std::string operands_to_string() const;
     void query_book( bool force_copy );
-    void from_book( const OpBookKey& key, const OpBookEntry& entry );
+    void from_book( const OpBookEntry& entry );
 
     Expr*           child_lhs   = nullptr;
     Expr*           child_rhs   = nullptr;
@@ -89,6 +90,7 @@ public:
     uint8_t         note        = 0;
     OpId            group       = OP_UNKNOWN;
     OpFn            fn          = nullptr;
+    const AttrFns*  attr_fns    = nullptr;
     const char*     name        = "UNKNOWN";
 };
 
@@ -118,6 +120,7 @@ public:
 
     Symbol  id              = "";
     int     stack_offset    = 0;
+    bool    last_use        = false;    // the stack slot is not read again, move out of it
 };
 
 class ValueLiteralExpr : public Expr
@@ -0,0 +1,73 @@
+// intern.cpp
+
+#include "intern.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+
+
+namespace MDDL {
+
+// the table holds a ref on each interned sequence, entries that nothing
+// else refers to anymore are dropped once the table has doubled
+static std::mutex table_mtx;
+static std::unordered_multimap<uint64_t, Sequence*>& table = *new std::unordered_multimap<uint64_t, Sequence*>;
+static size_t sweep_at = 64;
+
+static bool has_chunks( const Sequence& seq )
+{
+    return std::any_of( seq.pieces.cbegin(), seq.pieces.cend(), []( const Sequence::Piece& p ) {
+        return p.is_span();
+    } );
+}
+
+// a count of 1 is the table's own, no other ref can be taken but through it
+static void sweep()
+{
+    for ( auto it = table.begin(); it != table.end(); ) {
+        Sequence* seq = it->second;
+        if ( seq->ref_count.load( std::memory_order_acquire ) != 1 ) {
+            it ++;
+            continue;
+        }
+
+        it = table.erase( it );
+        delete seq;
+    }
+
+    sweep_at = std::max<size_t>( 64, table.size() * 2 );
+}
+
+void intern( Sequence& seq )
+{
+    seq.flush();
+
+    // runs already fit the inline pieces, there is no buffer to share
+    if ( !has_chunks( seq ) )
+        return;
+
+    const uint64_t h = seq.hash();
+
+    std::lock_guard<std::mutex> lock( table_mtx );
+
+    const auto [first, last] = table.equal_range( h );
+    for ( auto it = first; it != last; it ++ ) {
+        const Sequence& canon = *it->second;
+        if ( seq.same_elems( canon ) ) {
+            seq.pieces = canon.pieces;
+            return;
+        }
+    }
+
+    if ( table.size() >= sweep_at )
+        sweep();
+
+    // only a sequence the table holds stays immutable, so only it keeps its hash
+    seq.hash_cache = h;
+    seq.ref_count.fetch_add( 1, std::memory_order_relaxed );
+    table.emplace( h, &seq );
+}
+
+} // namespace MDDL
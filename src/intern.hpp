@@ -0,0 +1,20 @@
+// intern.hpp
+// Table of completed sequence literals by content, so that identical
+// literals recorded under different ids or scopes share their chunks.
+
+#ifndef __MDDL_INTERN_HPP__
+#define __MDDL_INTERN_HPP__
+
+#include "sequence.hpp"
+
+
+
+namespace MDDL {
+
+// the sequence must be immutable from here on.
+// it takes the pieces of an identical interned sequence, or is interned itself
+void intern( Sequence& seq );
+
+} // namespace MDDL
+
+#endif // __MDDL_INTERN_HPP__
@@ -76,6 +76,11 @@ void Interpreter::set_ppq( int ticks )
     scheduler.set_ppq( ticks );
 }
 
+void Interpreter::set_exec_mode( Runtime::Mode mode )
+{
+    runtime.mode = mode;
+}
+
 void Interpreter::on_message_callback( const MIDI::message& msg )
 {
     const std::lock_guard<std::mutex> lock( msg_queue_mtx );
@@ -295,18 +300,21 @@ void Interpreter::thread_run( const ExprRoot* entry )
     runtime.push_scope( program.global );
 
     std::cout << "\n";
+    MemStatsScope charged( &program.global->stats );
     DataRef v = DataType::ERROR;
     try {
-        v = runtime.execute( entry );
+        v = runtime.execute_root( program.global, entry );
     } catch ( const std::exception& err ) {
         std::cout << err.what() << "\n";
     }
+
+    if ( !v.empty() )
+        v.get().sync();
+
     repl_print( v );
     
-    if ( !v.empty() ) {
-        std::lock_guard<std::mutex> seq_guard( v.mtx() );
-        scheduler.add_sequence( v.get(), v.start, v.length() );
-    }
+    if ( !v.empty() )
+        scheduler.add_sequence( v.get(), v.start(), v.length() );
 
     v.release();
 }
@@ -361,5 +369,10 @@ void Interpreter::print() const
     program.print();
 }
 
+void Interpreter::print_stats() const
+{
+    program.print_stats();
+}
+
 } // namespace MDDL
 
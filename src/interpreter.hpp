@@ -39,6 +39,7 @@ public:
     void set_channel( uint8_t c );
     void set_tempo( int bpm );
     void set_ppq( int ticks );
+    void set_exec_mode( Runtime::Mode mode );
 
     void all_notes_off();
 
@@ -65,6 +66,7 @@ public:
     void stop();
 
     void print() const;
+    void print_stats() const;
 
 private:
     MIDI::midi_in       midi_in;
@@ -0,0 +1,84 @@
+// kernels.cpp
+
+#include "kernels_simd.hpp"
+
+#if defined( MDDL_KERNELS_X86 ) && defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+
+
+namespace MDDL {
+
+namespace {
+
+struct CpuFeatures
+{
+    bool sse4   = false;
+    bool avx2   = false;
+    bool avx512 = false;
+};
+
+CpuFeatures detect_cpu_features()
+{
+    CpuFeatures f;
+
+#if defined( MDDL_KERNELS_X86 ) && ( defined( __GNUC__ ) || defined( __clang__ ) )
+    __builtin_cpu_init();
+    f.sse4 = __builtin_cpu_supports( "sse4.1" );
+    f.avx2 = __builtin_cpu_supports( "avx2" );
+    f.avx512 = __builtin_cpu_supports( "avx512f" );
+#elif defined( MDDL_KERNELS_X86 ) && defined( _MSC_VER )
+    int r[4];
+    __cpuid( r, 0 );
+    const int max_leaf = r[0];
+
+    __cpuid( r, 1 );
+    f.sse4 = (r[2] >> 19) & 1;
+    const bool osxsave = (r[2] >> 27) & 1;
+    const unsigned long long xcr0 = osxsave ? _xgetbv( 0 ) : 0;
+
+    if ( max_leaf >= 7 ) {
+        __cpuidex( r, 7, 0 );
+        // ymm state for avx2, ymm + zmm + opmask state for avx-512
+        f.avx2 = ((r[1] >> 5) & 1) && (xcr0 & 0x06) == 0x06;
+        f.avx512 = ((r[1] >> 16) & 1) && (xcr0 & 0xE6) == 0xE6;
+    }
+#endif
+
+    return f;
+}
+
+KernelSet select_kernels()
+{
+    KernelSet k;
+    k.column_u8_u8 = scalar_column<uint8_t, uint8_t>;
+    k.column_u8_i32 = scalar_column<uint8_t, int32_t>;
+    k.column_i32_u8 = scalar_column<int32_t, uint8_t>;
+    k.column_i32_i32 = scalar_column<int32_t, int32_t>;
+    k.value_u8 = scalar_value<uint8_t>;
+    k.value_i32 = scalar_value<int32_t>;
+    k.affine_u8 = scalar_affine<uint8_t>;
+    k.affine_i32 = scalar_affine<int32_t>;
+
+    const CpuFeatures f = detect_cpu_features();
+
+    if ( f.avx512 && kernels_avx512( k ) )
+        return k;
+    if ( f.avx2 && kernels_avx2( k ) )
+        return k;
+    if ( f.sse4 && kernels_sse4( k ) )
+        return k;
+
+    return k;
+}
+
+} // namespace
+
+const KernelSet& kernels()
+{
+    static const KernelSet k = select_kernels();
+    return k;
+}
+
+} // namespace MDDL
@@ -0,0 +1,99 @@
+// kernels.hpp
+// Column arithmetic kernels with runtime CPU dispatch
+
+#ifndef __MDDL_KERNELS_HPP__
+#define __MDDL_KERNELS_HPP__
+
+#include <cstdint>
+
+
+
+namespace MDDL {
+
+enum class KernelOp {
+    ASSIGN,
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE
+};
+
+// wr[i] = wr[i] (op) (W )rd[i]
+typedef void (*KernelColumnU8U8)( KernelOp op, uint8_t* wr, const uint8_t* rd, int64_t length );
+typedef void (*KernelColumnU8I32)( KernelOp op, uint8_t* wr, const int32_t* rd, int64_t length );
+typedef void (*KernelColumnI32U8)( KernelOp op, int32_t* wr, const uint8_t* rd, int64_t length );
+typedef void (*KernelColumnI32I32)( KernelOp op, int32_t* wr, const int32_t* rd, int64_t length );
+
+// wr[i] = wr[i] (op) value
+typedef void (*KernelValueU8)( KernelOp op, uint8_t* wr, uint8_t value, int64_t length );
+typedef void (*KernelValueI32)( KernelOp op, int32_t* wr, int32_t value, int64_t length );
+
+// wr[i] = wr[i] * mul + add, wrapping
+typedef void (*KernelAffineU8)( uint8_t* wr, uint8_t mul, uint8_t add, int64_t length );
+typedef void (*KernelAffineI32)( int32_t* wr, int32_t mul, int32_t add, int64_t length );
+
+struct KernelSet
+{
+    const char*         name            = "scalar";
+    KernelColumnU8U8    column_u8_u8    = nullptr;
+    KernelColumnU8I32   column_u8_i32   = nullptr;
+    KernelColumnI32U8   column_i32_u8   = nullptr;
+    KernelColumnI32I32  column_i32_i32  = nullptr;
+    KernelValueU8       value_u8        = nullptr;
+    KernelValueI32      value_i32       = nullptr;
+    KernelAffineU8      affine_u8       = nullptr;
+    KernelAffineI32     affine_i32      = nullptr;
+};
+
+// selected once, on first use, from the best instruction set the cpu supports
+const KernelSet& kernels();
+
+inline void kernel_column( KernelOp op, uint8_t* wr, const uint8_t* rd, int64_t length )
+{
+    kernels().column_u8_u8( op, wr, rd, length );
+}
+
+inline void kernel_column( KernelOp op, uint8_t* wr, const int32_t* rd, int64_t length )
+{
+    kernels().column_u8_i32( op, wr, rd, length );
+}
+
+inline void kernel_column( KernelOp op, int32_t* wr, const uint8_t* rd, int64_t length )
+{
+    kernels().column_i32_u8( op, wr, rd, length );
+}
+
+inline void kernel_column( KernelOp op, int32_t* wr, const int32_t* rd, int64_t length )
+{
+    kernels().column_i32_i32( op, wr, rd, length );
+}
+
+inline void kernel_value( KernelOp op, uint8_t* wr, uint8_t value, int64_t length )
+{
+    kernels().value_u8( op, wr, value, length );
+}
+
+inline void kernel_value( KernelOp op, int32_t* wr, int32_t value, int64_t length )
+{
+    kernels().value_i32( op, wr, value, length );
+}
+
+inline void kernel_affine( uint8_t* wr, uint8_t mul, uint8_t add, int64_t length )
+{
+    kernels().affine_u8( wr, mul, add, length );
+}
+
+inline void kernel_affine( int32_t* wr, int32_t mul, int32_t add, int64_t length )
+{
+    kernels().affine_i32( wr, mul, add, length );
+}
+
+// instruction set specific tables, each built in its own translation unit
+// returns false if the build has no kernels for that instruction set
+bool kernels_sse4( KernelSet& k );
+bool kernels_avx2( KernelSet& k );
+bool kernels_avx512( KernelSet& k );
+
+} // namespace MDDL
+
+#endif // __MDDL_KERNELS_HPP__
@@ -0,0 +1,57 @@
+// kernels_avx2.cpp
+// built with -mavx2 on GCC/Clang
+
+#include "kernels_simd.hpp"
+
+
+
+namespace MDDL {
+
+#if defined( MDDL_KERNELS_X86 ) && ( defined( __AVX2__ ) || defined( _MSC_VER ) )
+
+namespace {
+
+struct AVX2
+{
+    typedef __m256i V;
+    static constexpr int LANES = 8;
+
+    static V load( const uint8_t* p ) { return _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i* )p ) ); }
+    static V load( const int32_t* p ) { return _mm256_loadu_si256( (const __m256i* )p ); }
+
+    static void store( uint8_t* p, V v )
+    {
+        // low byte of each lane to the bottom of its 128-bit half, then join the halves
+        const V low_bytes = _mm256_setr_epi8(
+            0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 );
+        const V packed = _mm256_permutevar8x32_epi32(
+            _mm256_shuffle_epi8( v, low_bytes ), _mm256_setr_epi32( 0, 4, 0, 0, 0, 0, 0, 0 ) );
+        _mm_storel_epi64( (__m128i* )p, _mm256_castsi256_si128( packed ) );
+    }
+    static void store( int32_t* p, V v ) { _mm256_storeu_si256( (__m256i* )p, v ); }
+
+    static V set1( int32_t x ) { return _mm256_set1_epi32( x ); }
+    static V add( V a, V b ) { return _mm256_add_epi32( a, b ); }
+    static V sub( V a, V b ) { return _mm256_sub_epi32( a, b ); }
+    static V mul( V a, V b ) { return _mm256_mullo_epi32( a, b ); }
+};
+
+} // namespace
+
+bool kernels_avx2( KernelSet& k )
+{
+    fill_kernel_set<AVX2>( k, "avx2" );
+    return true;
+}
+
+#else
+
+bool kernels_avx2( KernelSet& )
+{
+    return false;
+}
+
+#endif
+
+} // namespace MDDL
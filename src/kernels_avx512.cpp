@@ -0,0 +1,51 @@
+// kernels_avx512.cpp
+// built with -mavx512f on GCC/Clang
+
+#include "kernels_simd.hpp"
+
+
+
+namespace MDDL {
+
+#if defined( MDDL_KERNELS_X86 ) && ( defined( __AVX512F__ ) || defined( _MSC_VER ) )
+
+namespace {
+
+struct AVX512
+{
+    typedef __m512i V;
+    static constexpr int LANES = 16;
+
+    // full-mask forms, the unmasked ones trip -Wmaybe-uninitialized on GCC 12
+    static constexpr __mmask16 ALL = 0xFFFF;
+
+    static V load( const uint8_t* p ) { return _mm512_maskz_cvtepu8_epi32( ALL, _mm_loadu_si128( (const __m128i* )p ) ); }
+    static V load( const int32_t* p ) { return _mm512_loadu_si512( p ); }
+
+    static void store( uint8_t* p, V v ) { _mm512_mask_cvtepi32_storeu_epi8( p, ALL, v ); }
+    static void store( int32_t* p, V v ) { _mm512_storeu_si512( p, v ); }
+
+    static V set1( int32_t x ) { return _mm512_set1_epi32( x ); }
+    static V add( V a, V b ) { return _mm512_add_epi32( a, b ); }
+    static V sub( V a, V b ) { return _mm512_sub_epi32( a, b ); }
+    static V mul( V a, V b ) { return _mm512_mullo_epi32( a, b ); }
+};
+
+} // namespace
+
+bool kernels_avx512( KernelSet& k )
+{
+    fill_kernel_set<AVX512>( k, "avx512" );
+    return true;
+}
+
+#else
+
+bool kernels_avx512( KernelSet& )
+{
+    return false;
+}
+
+#endif
+
+} // namespace MDDL
@@ -0,0 +1,162 @@
+// kernels_simd.hpp
+// Kernel bodies shared by kernels.cpp and the kernels_<isa>.cpp files.
+// Everything here has internal linkage, so that each translation unit keeps
+// its own copy compiled with its own instruction set flags.
+
+#ifndef __MDDL_KERNELS_SIMD_HPP__
+#define __MDDL_KERNELS_SIMD_HPP__
+
+#include "kernels.hpp"
+
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __i386__ ) || defined( _M_IX86 )
+#define MDDL_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+
+
+namespace MDDL {
+namespace {
+
+template <typename W>
+inline void scalar_step( KernelOp op, W& a, W b )
+{
+    switch ( op ) {
+        case KernelOp::ASSIGN: a = b; break;
+        case KernelOp::ADD: a += b; break;
+        case KernelOp::SUBTRACT: a -= b; break;
+        case KernelOp::MULTIPLY: a *= b; break;
+        case KernelOp::DIVIDE: a /= b; break;
+    }
+}
+
+template <typename W, typename R>
+void scalar_column( KernelOp op, W* wr, const R* rd, int64_t length )
+{
+    for ( int64_t i = 0; i < length; i ++ )
+        scalar_step<W>( op, wr[i], (W )rd[i] );
+}
+
+template <typename W>
+void scalar_value( KernelOp op, W* wr, W value, int64_t length )
+{
+    for ( int64_t i = 0; i < length; i ++ )
+        scalar_step<W>( op, wr[i], value );
+}
+
+template <typename W>
+void scalar_affine( W* wr, W mul, W add, int64_t length )
+{
+    for ( int64_t i = 0; i < length; i ++ )
+        wr[i] = (W )((uint32_t )wr[i] * (uint32_t )mul + (uint32_t )add);
+}
+
+// vector kernels work in 32-bit lanes: uint8_t columns are zero-extended on
+// load and truncated on store, which gives the same low bits as the scalar ops
+
+// ISA provides V, LANES, load(), store(), set1(), add(), sub(), mul()
+template <typename ISA, KernelOp OP>
+inline typename ISA::V simd_step( typename ISA::V a, typename ISA::V b )
+{
+    if constexpr ( OP == KernelOp::ADD )
+        return ISA::add( a, b );
+    else if constexpr ( OP == KernelOp::SUBTRACT )
+        return ISA::sub( a, b );
+    else if constexpr ( OP == KernelOp::MULTIPLY )
+        return ISA::mul( a, b );
+    else
+        return b;
+}
+
+template <typename ISA, KernelOp OP, typename W, typename R>
+void simd_column_op( W* wr, const R* rd, int64_t length )
+{
+    int64_t i = 0;
+    for ( ; i + ISA::LANES <= length; i += ISA::LANES )
+        ISA::store( wr + i, simd_step<ISA, OP>( ISA::load( wr + i ), ISA::load( rd + i ) ) );
+
+    scalar_column( OP, wr + i, rd + i, length - i );
+}
+
+template <typename ISA, KernelOp OP, typename W>
+void simd_value_op( W* wr, W value, int64_t length )
+{
+    const typename ISA::V b = ISA::set1( (int32_t )value );
+
+    int64_t i = 0;
+    for ( ; i + ISA::LANES <= length; i += ISA::LANES )
+        ISA::store( wr + i, simd_step<ISA, OP>( ISA::load( wr + i ), b ) );
+
+    scalar_value( OP, wr + i, value, length - i );
+}
+
+template <typename ISA, typename W>
+void simd_affine( W* wr, W mul, W add, int64_t length )
+{
+    const typename ISA::V m = ISA::set1( (int32_t )mul );
+    const typename ISA::V a = ISA::set1( (int32_t )add );
+
+    int64_t i = 0;
+    for ( ; i + ISA::LANES <= length; i += ISA::LANES )
+        ISA::store( wr + i, ISA::add( ISA::mul( ISA::load( wr + i ), m ), a ) );
+
+    scalar_affine( wr + i, mul, add, length - i );
+}
+
+template <typename W, typename R>
+inline bool overlaps( const W* wr, const R* rd, int64_t length )
+{
+    const char* w = (const char* )wr;
+    const char* r = (const char* )rd;
+    return r < (const char* )(wr + length) && w < (const char* )(rd + length);
+}
+
+// no integer vector division, DIVIDE stays scalar
+// overlapping ranges also stay scalar to keep the element order of the scalar loop
+template <typename ISA, typename W, typename R>
+void simd_column( KernelOp op, W* wr, const R* rd, int64_t length )
+{
+    if ( overlaps( wr, rd, length ) ) {
+        scalar_column( op, wr, rd, length );
+        return;
+    }
+
+    switch ( op ) {
+        case KernelOp::ASSIGN: simd_column_op<ISA, KernelOp::ASSIGN>( wr, rd, length ); break;
+        case KernelOp::ADD: simd_column_op<ISA, KernelOp::ADD>( wr, rd, length ); break;
+        case KernelOp::SUBTRACT: simd_column_op<ISA, KernelOp::SUBTRACT>( wr, rd, length ); break;
+        case KernelOp::MULTIPLY: simd_column_op<ISA, KernelOp::MULTIPLY>( wr, rd, length ); break;
+        case KernelOp::DIVIDE: scalar_column( op, wr, rd, length ); break;
+    }
+}
+
+template <typename ISA, typename W>
+void simd_value( KernelOp op, W* wr, W value, int64_t length )
+{
+    switch ( op ) {
+        case KernelOp::ASSIGN: simd_value_op<ISA, KernelOp::ASSIGN>( wr, value, length ); break;
+        case KernelOp::ADD: simd_value_op<ISA, KernelOp::ADD>( wr, value, length ); break;
+        case KernelOp::SUBTRACT: simd_value_op<ISA, KernelOp::SUBTRACT>( wr, value, length ); break;
+        case KernelOp::MULTIPLY: simd_value_op<ISA, KernelOp::MULTIPLY>( wr, value, length ); break;
+        case KernelOp::DIVIDE: scalar_value( op, wr, value, length ); break;
+    }
+}
+
+template <typename ISA>
+void fill_kernel_set( KernelSet& k, const char* name )
+{
+    k.name = name;
+    k.column_u8_u8 = simd_column<ISA, uint8_t, uint8_t>;
+    k.column_u8_i32 = simd_column<ISA, uint8_t, int32_t>;
+    k.column_i32_u8 = simd_column<ISA, int32_t, uint8_t>;
+    k.column_i32_i32 = simd_column<ISA, int32_t, int32_t>;
+    k.value_u8 = simd_value<ISA, uint8_t>;
+    k.value_i32 = simd_value<ISA, int32_t>;
+    k.affine_u8 = simd_affine<ISA, uint8_t>;
+    k.affine_i32 = simd_affine<ISA, int32_t>;
+}
+
+} // namespace
+} // namespace MDDL
+
+#endif // __MDDL_KERNELS_SIMD_HPP__
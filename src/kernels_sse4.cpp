@@ -0,0 +1,52 @@
+// kernels_sse4.cpp
+// built with -msse4.1 on GCC/Clang
+
+#include "kernels_simd.hpp"
+
+
+
+namespace MDDL {
+
+#if defined( MDDL_KERNELS_X86 ) && ( defined( __SSE4_1__ ) || defined( _MSC_VER ) )
+
+namespace {
+
+struct SSE4
+{
+    typedef __m128i V;
+    static constexpr int LANES = 4;
+
+    static V load( const uint8_t* p ) { return _mm_cvtepu8_epi32( _mm_loadu_si32( p ) ); }
+    static V load( const int32_t* p ) { return _mm_loadu_si128( (const __m128i* )p ); }
+
+    static void store( uint8_t* p, V v )
+    {
+        const V low_bytes = _mm_setr_epi8( 0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 );
+        _mm_storeu_si32( p, _mm_shuffle_epi8( v, low_bytes ) );
+    }
+    static void store( int32_t* p, V v ) { _mm_storeu_si128( (__m128i* )p, v ); }
+
+    static V set1( int32_t x ) { return _mm_set1_epi32( x ); }
+    static V add( V a, V b ) { return _mm_add_epi32( a, b ); }
+    static V sub( V a, V b ) { return _mm_sub_epi32( a, b ); }
+    static V mul( V a, V b ) { return _mm_mullo_epi32( a, b ); }
+};
+
+} // namespace
+
+bool kernels_sse4( KernelSet& k )
+{
+    fill_kernel_set<SSE4>( k, "sse4.1" );
+    return true;
+}
+
+#else
+
+bool kernels_sse4( KernelSet& )
+{
+    return false;
+}
+
+#endif
+
+} // namespace MDDL
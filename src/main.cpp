@@ -48,6 +48,16 @@ int main( int argc, char** argv )
         "List all available MIDI ports.", { "ports" } );
     args::Flag args_time( parser, "time",
         "Time input files.", { "time" } );
+    args::Flag args_stats( parser, "stats",
+        "Print memory usage of sequences on exit.", { "stats" } );
+    args::ValueFlag<int> args_mem_limit( parser, "MiB",
+        "Raise a runtime error once sequences exceed this much memory.", { "mem-limit" } );
+    args::ValueFlag<int> args_spill( parser, "MiB",
+        "Back sequence storage blocks of this size or more by temp files (0 to disable).", { "spill" } );
+    args::ValueFlag<std::string> args_spill_dir( parser, "dir",
+        "Directory for spilled sequence storage.", { "spill-dir" } );
+    args::Flag args_tree( parser, "tree",
+        "Execute by walking the expression tree instead of compiling to bytecode.", { "tree" } );
     args::Flag args_translate( parser, "translate",
         "Print text syntax translation of input files without executing.",
         { "translate" } );
@@ -80,8 +90,20 @@ int main( int argc, char** argv )
         return 0;
     }
 
+    if ( args_mem_limit )
+        MemStats::limit = (int64_t )args::get( args_mem_limit ) * 1024 * 1024;
+
+    if ( args_spill )
+        spill_threshold = (size_t )std::max( args::get( args_spill ), 0 ) * 1024 * 1024;
+
+    if ( args_spill_dir )
+        spill_dir = args::get( args_spill_dir );
+
     Interpreter mddl( obs );
 
+    if ( args_tree )
+        mddl.set_exec_mode( Runtime::Mode::TREE );
+
     if ( args_port_in ) {
         const int port_idx = args::get( args_port_in );
         if ( port_idx < 0 || port_idx >= (int )ports_in.size() ) {
@@ -128,11 +150,16 @@ int main( int argc, char** argv )
         const std::chrono::duration<float>  total_time = std::chrono::steady_clock::now() - start_clock;
         std::cout << "Run Time: " << run_time.count() << "s\n";
         std::cout << "Total Time: " << run_time.count() << "s\n";
-        return 0;
     }
 
-    if ( !args_port_in )
+    if ( args_time || !args_port_in ) {
+        mddl.join();
+
+        if ( args_stats )
+            mddl.print_stats();
+
         return 0;
+    }
 
     // enter REPL
 
@@ -140,5 +167,8 @@ int main( int argc, char** argv )
     mddl.listen();
     mddl.join();
 
+    if ( args_stats )
+        mddl.print_stats();
+
     return 0;
 }
\ No newline at end of file
@@ -7,6 +7,8 @@
 
 #include <cassert>
 #include <iostream>
+#include <type_traits>
+#include <utility>
 
 
 namespace MDDL {
@@ -16,23 +18,23 @@ static const char* SUBSEQ_RESIZE_ERR    = "Cannot resize subsequence.";
 static const char* SUBSEQ_CONCAT_ERR    = "Cannot concatenate to subsequence.";
 static const char* INDEX_BOUNDS_ERR     = "Index is outside sequence bounds.";
 
-static const char* NEW          = "NEW";
-static const char* COMPLETE     = "COMPLETE";
-static const char* ASSIGN       = "ASSIGN";
-static const char* VALUE        = "VALUE";
-static const char* CONCAT       = "CONCAT";
-static const char* EXTEND       = "EXTEND";
-static const char* INDEX        = "INDEX";
-static const char* LENGTH       = "LENGTH";
-static const char* COMPARE      = "COMPARE";
-static const char* PITCH        = "PITCH";
-static const char* ADD          = "ADD";
-static const char* VELOCITY     = "VELOCITY";
-static const char* SUBTRACT     = "SUBTRACT";
-static const char* DURATION     = "DURATION";
-static const char* MULTIPLY     = "MULTIPLY";
-static const char* WAIT         = "WAIT";
-static const char* DIVIDE       = "DIVIDE";
+static constexpr const char* NEW          = "NEW";
+static constexpr const char* COMPLETE     = "COMPLETE";
+static constexpr const char* ASSIGN       = "ASSIGN";
+static constexpr const char* VALUE        = "VALUE";
+static constexpr const char* CONCAT       = "CONCAT";
+static constexpr const char* EXTEND       = "EXTEND";
+static constexpr const char* INDEX        = "INDEX";
+static constexpr const char* LENGTH       = "LENGTH";
+static constexpr const char* COMPARE      = "COMPARE";
+static constexpr const char* PITCH        = "PITCH";
+static constexpr const char* ADD          = "ADD";
+static constexpr const char* VELOCITY     = "VELOCITY";
+static constexpr const char* SUBTRACT     = "SUBTRACT";
+static constexpr const char* DURATION     = "DURATION";
+static constexpr const char* MULTIPLY     = "MULTIPLY";
+static constexpr const char* WAIT         = "WAIT";
+static constexpr const char* DIVIDE       = "DIVIDE";
 
 
 inline DataRef& get_stack_ref( Runtime* rt, DataRef ref )
@@ -45,6 +47,49 @@ static int64_t compare( int64_t a, int64_t b )
     return (int16_t )(a < b);
 }
 
+// attr ops are instantiated for the attr members of their operands when those are known
+// at build time (see make_attr_fns), M = nullptr dispatches on the operands' attrs instead
+template <auto M>
+constexpr bool attr_known()
+{
+    return !std::is_same_v<decltype( M ), std::nullptr_t>;
+}
+
+template <int A>
+constexpr auto attr_member()
+{
+    using Elem = Sequence::Elem;
+    if constexpr ( A == (int )AttrType::PITCH ) return &Elem::pitch;
+    else if constexpr ( A == (int )AttrType::VELOCITY ) return &Elem::vel;
+    else if constexpr ( A == (int )AttrType::DURATION ) return &Elem::dur;
+    else return &Elem::wait;
+}
+
+#define MDDL_ATTR_KERNEL( kernel ) \
+    template <auto M1, auto M2> \
+    static void kernel ## _k( Sequence& seq, [[maybe_unused]] AttrType attr, [[maybe_unused]] AttrType rhs_attr, \
+        int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length ) \
+    { \
+        if constexpr ( attr_known<M1>() ) \
+            seq.kernel ## _attr<M1, M2>( start, rhs, rhs_start, length ); \
+        else \
+            seq.kernel( attr, rhs_attr, start, rhs, rhs_start, length ); \
+    } \
+    \
+    template <auto M> \
+    static void kernel ## _value_k( Sequence& seq, [[maybe_unused]] AttrType attr, int64_t start, int64_t length, int64_t value ) \
+    { \
+        if constexpr ( attr_known<M>() ) \
+            seq.kernel ## _value_attr<M>( start, length, value ); \
+        else \
+            seq.kernel ## _value( attr, start, length, value ); \
+    }
+
+MDDL_ATTR_KERNEL( add )
+MDDL_ATTR_KERNEL( subtract )
+MDDL_ATTR_KERNEL( multiply )
+MDDL_ATTR_KERNEL( divide )
+
 // Function implementations
 
 #define MDDL_OP_FN( group, lhs_t, rhs_t )    \
@@ -53,6 +98,10 @@ static int64_t compare( int64_t a, int64_t b )
 #define MDDL_OP_IMPL( group, name, lhs_t, rhs_t, return_t ) \
     DataRef MDDL_OP_FN( group, lhs_t, rhs_t )( Runtime* rt [[maybe_unused]], DataRef& lhs [[maybe_unused]], DataRef& rhs [[maybe_unused]] )
 
+#define MDDL_ATTR_OP_IMPL( group, name, lhs_t, rhs_t, return_t ) \
+    template <auto M1 = nullptr, auto M2 = nullptr> \
+    MDDL_OP_IMPL( group, name, lhs_t, rhs_t, return_t )
+
 
 
 // DO, or NEW/ASSIGN
@@ -68,9 +117,8 @@ MDDL_OP_IMPL( OP_DO, NEW, VALUE, NONE, VSEQ )
 
 MDDL_OP_IMPL( OP_DO, COMPLETE, SEQ_LIT, NONE, VSEQ )
 {
-    while ( !lhs.get().complete )
-        ief_sleep( 10 );
-
+    lhs.get().wait_complete();
+    lhs.get().sync();
     return lhs.elide_copy();
 }
 
@@ -79,7 +127,7 @@ MDDL_OP_IMPL( OP_DO, ASSIGN, SEQ, SEQ, SEQ )
     DataRef& var = get_stack_ref( rt, lhs.move() );
     lhs.release();
     var.release();
-    var.take( rhs.move() );
+    var.take( rt->promote( rhs.move() ) );
     return var.duplicate();
 }
 
@@ -90,13 +138,14 @@ MDDL_OP_IMPL( OP_DO, SET, SEQ, VSEQ, SEQ )
 
         rt_assert( v.length() <= rhs.length(), SUBSEQ_BOUNDS_ERR );
 
-        v.get().assign( v.start, rhs.get(), rhs.start, rhs.length() );
+        v.get().assign( v.start(), rhs.get(), rhs.start(), rhs.length() );
+        rhs.release();
         return v;
     }
 
     DataRef& var = get_stack_ref( rt, lhs );
     lhs.release();
-    var.take( rhs.elide_copy() );
+    var.take( rt->promote( rhs.elide_copy() ) );
     return var.duplicate();
 }
 
@@ -110,7 +159,7 @@ MDDL_OP_IMPL( OP_DO, SET, SEQ, VATTR, SEQ )
         v.get().expect( rhs.length() );
     }
 
-    v.get().assign( rhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    v.get().assign( rhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -137,7 +186,7 @@ MDDL_OP_IMPL( OP_DO, SET, VSEQ, VATTR, VSEQ )
     DataRef v = lhs.elide_copy();
 
     v.get().expect( rhs.length() );
-    v.get().assign( rhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    v.get().assign( rhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -145,7 +194,7 @@ MDDL_OP_IMPL( OP_DO, SET, VSEQ, VATTR, VSEQ )
 MDDL_OP_IMPL( OP_DO, RESIZE, VSEQ, VALUE, VSEQ )
 {
     DataRef v = lhs.elide_copy();
-    v.ref->resize( rhs.value );
+    v.get().resize( rhs.value );
     return v;
 }
 
@@ -159,7 +208,7 @@ MDDL_OP_IMPL( OP_DO, SET, ATTR, VSEQ, ATTR )
         v.get().expect( rhs.length() );
     }
 
-    v.get().assign( v.attr, v.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    v.get().assign( v.attr, v.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -171,10 +220,10 @@ MDDL_OP_IMPL( OP_DO, SET, ATTR, VATTR, ATTR )
     if ( v.is_subseq() ) {
         rt_assert( v.length() <= rhs.length(), SUBSEQ_BOUNDS_ERR );
     } else {
-        v.ref->expect( rhs.length() );
+        v.get().expect( rhs.length() );
     }
 
-    v.get().assign( v.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    v.get().assign( v.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -182,7 +231,7 @@ MDDL_OP_IMPL( OP_DO, SET, ATTR, VATTR, ATTR )
 MDDL_OP_IMPL( OP_DO, SET, ATTR, VALUE, ATTR )
 {
     DataRef v = lhs.move();
-    v.get().assign_value( v.attr, v.start, v.length(), rhs.value );
+    v.get().assign_value( v.attr, v.start(), v.length(), rhs.value );
     rhs.release();
     return v;
 }
@@ -191,7 +240,7 @@ MDDL_OP_IMPL( OP_DO, SET, VATTR, VSEQ, VATTR )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().assign( v.attr, v.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    v.get().assign( v.attr, v.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -200,7 +249,7 @@ MDDL_OP_IMPL( OP_DO, SET, VATTR, VATTR, VATTR )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().assign( v.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    v.get().assign( v.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -208,7 +257,7 @@ MDDL_OP_IMPL( OP_DO, SET, VATTR, VATTR, VATTR )
 MDDL_OP_IMPL( OP_DO, SET, VATTR, VALUE, VATTR )
 {
     DataRef v = lhs.elide_copy();
-    v.get().assign_value( v.attr, v.start, v.length(), rhs.value );
+    v.get().assign_value( v.attr, v.start(), v.length(), rhs.value );
     rhs.release();
     return v;
 }
@@ -240,7 +289,7 @@ MDDL_OP_IMPL( OP_RE, CONCAT, SEQ, VSEQ, SEQ )
     DataRef v = lhs.move();
 
     rt_assert( !v.is_subseq(), SUBSEQ_CONCAT_ERR );
-    v.get().concat( rhs.get(), rhs.start, rhs.length() );
+    v.get().concat( rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -251,7 +300,7 @@ MDDL_OP_IMPL( OP_RE, CONCAT, SEQ, VATTR, SEQ )
 
     rt_assert( !v.is_subseq(), SUBSEQ_CONCAT_ERR );
     
-    v.get().concat( rhs.attr, rhs.attr, rhs.get(), rhs.start, rhs.length() );
+    v.get().concat( rhs.attr, rhs.attr, rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -271,7 +320,7 @@ MDDL_OP_IMPL( OP_RE, CONCAT, VSEQ, VSEQ, VSEQ )
 {
     DataRef v = lhs.elide_copy();
 
-    v.get().concat( rhs.get(), rhs.start, rhs.length() );
+    v.get().concat( rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -280,7 +329,7 @@ MDDL_OP_IMPL( OP_RE, CONCAT, VSEQ, VATTR, VSEQ )
 {
     DataRef v = lhs.elide_copy();
 
-    v.get().concat( rhs.attr, rhs.attr, rhs.get(), rhs.start, rhs.length() );
+    v.get().concat( rhs.attr, rhs.attr, rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -299,7 +348,7 @@ MDDL_OP_IMPL( OP_RE, CONCAT, ATTR, VSEQ, ATTR )
 
     rt_assert( !v.is_subseq(), SUBSEQ_CONCAT_ERR );
     
-    v.get().concat( lhs.attr, lhs.attr, rhs.get(), rhs.start, rhs.length() );
+    v.get().concat( lhs.attr, lhs.attr, rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -310,7 +359,7 @@ MDDL_OP_IMPL( OP_RE, CONCAT, ATTR, VATTR, ATTR )
 
     rt_assert( !v.is_subseq(), SUBSEQ_CONCAT_ERR );
     
-    v.get().concat( lhs.attr, rhs.attr, rhs.get(), rhs.start, rhs.length() );
+    v.get().concat( lhs.attr, rhs.attr, rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -330,7 +379,7 @@ MDDL_OP_IMPL( OP_RE, CONCAT, VATTR, VSEQ, VATTR )
 {
     DataRef v = lhs.elide_copy();
 
-    v.get().concat( lhs.attr, lhs.attr, rhs.get(), rhs.start, rhs.length() );
+    v.get().concat( lhs.attr, lhs.attr, rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -339,7 +388,7 @@ MDDL_OP_IMPL( OP_RE, CONCAT, VATTR, VATTR, VATTR )
 {
     DataRef v = lhs.elide_copy();
 
-    v.get().concat( lhs.attr, rhs.attr, rhs.get(), rhs.start, rhs.length() );
+    v.get().concat( lhs.attr, rhs.attr, rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -353,23 +402,36 @@ MDDL_OP_IMPL( OP_RE, EXTEND, VATTR, VALUE, VATTR )
     return v;
 }
 
+// an index past the notes recorded so far waits for them to be played,
+// the literal may still complete with fewer
+static void await_recorded( DataRef& ref, int64_t end )
+{
+    Sequence& seq = ref.get();
+    if ( seq.rec == nullptr || ref.is_subseq() || end <= seq.size )
+        return;
+
+    seq.wait_recorded( end );
+    seq.sync();
+}
+
 MDDL_OP_IMPL( OP_RE, INDEX, VALUE, SEQ, SEQ )
 {
-    const int64_t idx = rhs.start + lhs.value;
+    const int64_t idx = rhs.start() + lhs.value;
+    await_recorded( rhs, idx + 1 );
     rt_assert( idx >= 0 && idx < rhs.length(), INDEX_BOUNDS_ERR );
 
     DataRef v = rhs.move();
-    v.start = idx;
-    v.size = 1;
+    v.set_range( idx, 1 );
     return v;
 }
 
 MDDL_OP_IMPL( OP_RE, INDEX, VALUE, VSEQ, VSEQ )
 {
-    const int64_t idx = rhs.start + lhs.value;
+    const int64_t idx = rhs.start() + lhs.value;
+    await_recorded( rhs, idx + 1 );
     rt_assert( idx >= 0 && idx < rhs.length(), INDEX_BOUNDS_ERR );
 
-    const Sequence::Elem& elem = rhs.get().at( idx );
+    const Sequence::Elem elem = rhs.get().at( idx );
     DataRef v( DataType::VSEQ, new Sequence( elem ) );
     rhs.release();
     return v;
@@ -378,21 +440,22 @@ MDDL_OP_IMPL( OP_RE, INDEX, VALUE, VSEQ, VSEQ )
 
 MDDL_OP_IMPL( OP_RE, INDEX, VALUE, ATTR, ATTR )
 {
-    const int64_t idx = rhs.start + lhs.value;
+    const int64_t idx = rhs.start() + lhs.value;
+    await_recorded( rhs, idx + 1 );
     rt_assert( idx >= 0 && idx < rhs.length(), INDEX_BOUNDS_ERR );
 
     DataRef v = rhs.move();
-    v.start = idx;
-    v.size = 1;
+    v.set_range( idx, 1 );
     return v;
 }
 
 MDDL_OP_IMPL( OP_RE, INDEX, VALUE, VATTR, VATTR )
 {
-    const int64_t idx = rhs.start + lhs.value;
+    const int64_t idx = rhs.start() + lhs.value;
+    await_recorded( rhs, idx + 1 );
     rt_assert( idx >= 0 && idx < rhs.length(), INDEX_BOUNDS_ERR );
 
-    const Sequence::Elem& elem = rhs.get().at( idx );
+    const Sequence::Elem elem = rhs.get().at( idx );
     DataRef v( DataType::VSEQ, new Sequence( elem ) );
     rhs.release();
     return v;
@@ -401,57 +464,60 @@ MDDL_OP_IMPL( OP_RE, INDEX, VALUE, VATTR, VATTR )
 MDDL_OP_IMPL( OP_RE, INDEX, VALUE, VALUE, INDEXER )
 {
     DataRef v = DataType::INDEXER;
-    v.start = lhs.value;
-    v.size = rhs.value - lhs.value;
+    v.set_range( lhs.value, rhs.value - lhs.value );
     return v;
 }
 
 MDDL_OP_IMPL( OP_RE, INDEX, INDEXER, SEQ, SEQ )
 {
-    const int64_t start = rhs.start + lhs.start;
-    const int64_t size = lhs.size;
+    const int64_t start = rhs.start() + lhs.start();
+    const int64_t size = lhs.size();
+    lhs.release();
+    await_recorded( rhs, start + size );
     rt_assert( start >= 0 && start < rhs.length() && size <= rhs.length(), INDEX_BOUNDS_ERR );
 
     DataRef v = rhs.move();
-    v.start = start;
-    v.size = size;
+    v.set_range( start, size );
     return v;
 }
 
 MDDL_OP_IMPL( OP_RE, INDEX, INDEXER, VSEQ, VSEQ )
 {
-    const int64_t start = rhs.start + lhs.start;
-    const int64_t size = lhs.size;
+    const int64_t start = rhs.start() + lhs.start();
+    const int64_t size = lhs.size();
+    lhs.release();
+    await_recorded( rhs, start + size );
     rt_assert( start >= 0 && start < rhs.length() && size <= rhs.length(), INDEX_BOUNDS_ERR );
 
-    DataRef v = rhs.elide_copy();
-    v.start = start;
-    v.size = size;
-    return v;
+    // only the indexed range is taken
+    rhs.set_range( start, size );
+    return rhs.elide_copy();
 }
 
 MDDL_OP_IMPL( OP_RE, INDEX, INDEXER, ATTR, ATTR )
 {
-    const int64_t start = rhs.start + lhs.start;
-    const int64_t size = lhs.size;
+    const int64_t start = rhs.start() + lhs.start();
+    const int64_t size = lhs.size();
+    lhs.release();
+    await_recorded( rhs, start + size );
     rt_assert( start >= 0 && start < rhs.length() && size <= rhs.length(), INDEX_BOUNDS_ERR );
 
     DataRef v = rhs.move();
-    v.start = start;
-    v.size = size;
+    v.set_range( start, size );
     return v;
 }
 
 MDDL_OP_IMPL( OP_RE, INDEX, INDEXER, VATTR, VATTR )
 {
-    const int64_t start = rhs.start + lhs.start;
-    const int64_t size = lhs.size;
+    const int64_t start = rhs.start() + lhs.start();
+    const int64_t size = lhs.size();
+    lhs.release();
+    await_recorded( rhs, start + size );
     rt_assert( start >= 0 && start < rhs.length() && size <= rhs.length(), INDEX_BOUNDS_ERR );
 
-    DataRef v = rhs.elide_copy();
-    v.start = start;
-    v.size = size;
-    return v;
+    // only the indexed range is taken
+    rhs.set_range( start, size );
+    return rhs.elide_copy();
 }
 
 
@@ -573,12 +639,12 @@ MDDL_OP_IMPL( OP_FA, ADD, SEQ, VSEQ, SEQ )
         v.get().expect( rhs.length() );
     }
 
-    v.get().add( v.start, rhs.get(), rhs.start, rhs.length() );
+    v.get().add( v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_FA, ADD, SEQ, VATTR, SEQ )
+MDDL_ATTR_OP_IMPL( OP_FA, ADD, SEQ, VATTR, SEQ )
 {
     DataRef v = lhs.move();
     
@@ -588,7 +654,7 @@ MDDL_OP_IMPL( OP_FA, ADD, SEQ, VATTR, SEQ )
         v.get().expect( rhs.length() );
     }
 
-    v.get().add( rhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    add_k<M1, M2>( v.get(), rhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -607,16 +673,16 @@ MDDL_OP_IMPL( OP_FA, ADD, VSEQ, VSEQ, VSEQ )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().add( v.start, rhs.get(), rhs.start, rhs.length() );
+    v.get().add( v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_FA, ADD, VSEQ, VATTR, VSEQ )
+MDDL_ATTR_OP_IMPL( OP_FA, ADD, VSEQ, VATTR, VSEQ )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().add( rhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    add_k<M1, M2>( v.get(), rhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -628,7 +694,7 @@ MDDL_OP_IMPL( OP_FA, ADD, VSEQ, VALUE, VSEQ )
     return v;
 }
 
-MDDL_OP_IMPL( OP_FA, ADD, ATTR, VSEQ, ATTR )
+MDDL_ATTR_OP_IMPL( OP_FA, ADD, ATTR, VSEQ, ATTR )
 {
     DataRef v = lhs.move();
     
@@ -638,12 +704,12 @@ MDDL_OP_IMPL( OP_FA, ADD, ATTR, VSEQ, ATTR )
         v.get().expect( rhs.length() );
     }
 
-    v.get().add( lhs.attr, lhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    add_k<M1, M2>( v.get(), lhs.attr, lhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_FA, ADD, ATTR, VATTR, ATTR )
+MDDL_ATTR_OP_IMPL( OP_FA, ADD, ATTR, VATTR, ATTR )
 {
     DataRef v = lhs.move();
     
@@ -653,40 +719,40 @@ MDDL_OP_IMPL( OP_FA, ADD, ATTR, VATTR, ATTR )
         v.get().expect( rhs.length() );
     }
 
-    v.get().add( lhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    add_k<M1, M2>( v.get(), lhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_FA, ADD, ATTR, VALUE, ATTR )
+MDDL_ATTR_OP_IMPL( OP_FA, ADD, ATTR, VALUE, ATTR )
 {
     DataRef v = lhs.move();
-    v.get().add_value( lhs.attr, v.start, v.length(), rhs.value );
+    add_value_k<M1>( v.get(), lhs.attr, v.start(), v.length(), rhs.value );
     return v;
 }
 
-MDDL_OP_IMPL( OP_FA, ADD, VATTR, VSEQ, VATTR )
+MDDL_ATTR_OP_IMPL( OP_FA, ADD, VATTR, VSEQ, VATTR )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().add( lhs.attr, lhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    add_k<M1, M2>( v.get(), lhs.attr, lhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_FA, ADD, VATTR, VATTR, VATTR )
+MDDL_ATTR_OP_IMPL( OP_FA, ADD, VATTR, VATTR, VATTR )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().add( lhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    add_k<M1, M2>( v.get(), lhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_FA, ADD, VATTR, VALUE, VATTR )
+MDDL_ATTR_OP_IMPL( OP_FA, ADD, VATTR, VALUE, VATTR )
 {
     DataRef v = lhs.elide_copy();
-    v.get().add_value( lhs.attr, v.start, v.get().size, rhs.value );
+    add_value_k<M1>( v.get(), lhs.attr, v.start(), v.get().size, rhs.value );
     return v;
 }
 
@@ -729,12 +795,12 @@ MDDL_OP_IMPL( OP_SO, SUBTRACT, SEQ, VSEQ, SEQ )
         v.get().expect( rhs.length() );
     }
 
-    v.get().subtract( v.start, rhs.get(), rhs.start, rhs.length() );
+    v.get().subtract( v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_SO, SUBTRACT, SEQ, VATTR, SEQ )
+MDDL_ATTR_OP_IMPL( OP_SO, SUBTRACT, SEQ, VATTR, SEQ )
 {
     DataRef v = lhs.move();
     
@@ -744,7 +810,7 @@ MDDL_OP_IMPL( OP_SO, SUBTRACT, SEQ, VATTR, SEQ )
         v.get().expect( rhs.length() );
     }
 
-    v.get().subtract( rhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    subtract_k<M1, M2>( v.get(), rhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -763,16 +829,16 @@ MDDL_OP_IMPL( OP_SO, SUBTRACT, VSEQ, VSEQ, VSEQ )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().subtract( v.start, rhs.get(), rhs.start, rhs.length() );
+    v.get().subtract( v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_SO, SUBTRACT, VSEQ, VATTR, VSEQ )
+MDDL_ATTR_OP_IMPL( OP_SO, SUBTRACT, VSEQ, VATTR, VSEQ )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().subtract( rhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    subtract_k<M1, M2>( v.get(), rhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -784,7 +850,7 @@ MDDL_OP_IMPL( OP_SO, SUBTRACT, VSEQ, VALUE, VSEQ )
     return v;
 }
 
-MDDL_OP_IMPL( OP_SO, SUBTRACT, ATTR, VSEQ, ATTR )
+MDDL_ATTR_OP_IMPL( OP_SO, SUBTRACT, ATTR, VSEQ, ATTR )
 {
     DataRef v = lhs.move();
     
@@ -794,12 +860,12 @@ MDDL_OP_IMPL( OP_SO, SUBTRACT, ATTR, VSEQ, ATTR )
         v.get().expect( rhs.length() );
     }
 
-    v.get().subtract( lhs.attr, lhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    subtract_k<M1, M2>( v.get(), lhs.attr, lhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_SO, SUBTRACT, ATTR, VATTR, ATTR )
+MDDL_ATTR_OP_IMPL( OP_SO, SUBTRACT, ATTR, VATTR, ATTR )
 {
     DataRef v = lhs.move();
     
@@ -809,40 +875,40 @@ MDDL_OP_IMPL( OP_SO, SUBTRACT, ATTR, VATTR, ATTR )
         v.get().expect( rhs.length() );
     }
 
-    v.get().subtract( lhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    subtract_k<M1, M2>( v.get(), lhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_SO, SUBTRACT, ATTR, VALUE, ATTR )
+MDDL_ATTR_OP_IMPL( OP_SO, SUBTRACT, ATTR, VALUE, ATTR )
 {
     DataRef v = lhs.move();
-    v.get().subtract_value( lhs.attr, v.start, v.length(), rhs.value );
+    subtract_value_k<M1>( v.get(), lhs.attr, v.start(), v.length(), rhs.value );
     return v;
 }
 
-MDDL_OP_IMPL( OP_SO, SUBTRACT, VATTR, VSEQ, VATTR )
+MDDL_ATTR_OP_IMPL( OP_SO, SUBTRACT, VATTR, VSEQ, VATTR )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().subtract( lhs.attr, lhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    subtract_k<M1, M2>( v.get(), lhs.attr, lhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_SO, SUBTRACT, VATTR, VATTR, VATTR )
+MDDL_ATTR_OP_IMPL( OP_SO, SUBTRACT, VATTR, VATTR, VATTR )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().subtract( lhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    subtract_k<M1, M2>( v.get(), lhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_SO, SUBTRACT, VATTR, VALUE, VATTR )
+MDDL_ATTR_OP_IMPL( OP_SO, SUBTRACT, VATTR, VALUE, VATTR )
 {
     DataRef v = lhs.elide_copy();
-    v.get().subtract_value( lhs.attr, v.start, v.get().size, rhs.value );
+    subtract_value_k<M1>( v.get(), lhs.attr, v.start(), v.get().size, rhs.value );
     return v;
 }
 
@@ -880,12 +946,12 @@ MDDL_OP_IMPL( OP_LA, MULTIPLY, SEQ, VSEQ, SEQ )
         v.get().expect( rhs.length() );
     }
 
-    v.get().multiply( v.start, rhs.get(), rhs.start, rhs.length() );
+    v.get().multiply( v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_LA, MULTIPLY, SEQ, VATTR, SEQ )
+MDDL_ATTR_OP_IMPL( OP_LA, MULTIPLY, SEQ, VATTR, SEQ )
 {
     DataRef v = lhs.move();
     
@@ -895,7 +961,7 @@ MDDL_OP_IMPL( OP_LA, MULTIPLY, SEQ, VATTR, SEQ )
         v.get().expect( rhs.length() );
     }
 
-    v.get().multiply( rhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    multiply_k<M1, M2>( v.get(), rhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -914,16 +980,16 @@ MDDL_OP_IMPL( OP_LA, MULTIPLY, VSEQ, VSEQ, VSEQ )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().multiply( v.start, rhs.get(), rhs.start, rhs.length() );
+    v.get().multiply( v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_LA, MULTIPLY, VSEQ, VATTR, VSEQ )
+MDDL_ATTR_OP_IMPL( OP_LA, MULTIPLY, VSEQ, VATTR, VSEQ )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().multiply( rhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    multiply_k<M1, M2>( v.get(), rhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -935,7 +1001,7 @@ MDDL_OP_IMPL( OP_LA, MULTIPLY, VSEQ, VALUE, VSEQ )
     return v;
 }
 
-MDDL_OP_IMPL( OP_LA, MULTIPLY, ATTR, VSEQ, ATTR )
+MDDL_ATTR_OP_IMPL( OP_LA, MULTIPLY, ATTR, VSEQ, ATTR )
 {
     DataRef v = lhs.move();
     
@@ -945,12 +1011,12 @@ MDDL_OP_IMPL( OP_LA, MULTIPLY, ATTR, VSEQ, ATTR )
         v.get().expect( rhs.length() );
     }
 
-    v.get().multiply( lhs.attr, lhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    multiply_k<M1, M2>( v.get(), lhs.attr, lhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_LA, MULTIPLY, ATTR, VATTR, ATTR )
+MDDL_ATTR_OP_IMPL( OP_LA, MULTIPLY, ATTR, VATTR, ATTR )
 {
     DataRef v = lhs.move();
     
@@ -960,40 +1026,40 @@ MDDL_OP_IMPL( OP_LA, MULTIPLY, ATTR, VATTR, ATTR )
         v.get().expect( rhs.length() );
     }
 
-    v.get().multiply( lhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    multiply_k<M1, M2>( v.get(), lhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_LA, MULTIPLY, ATTR, VALUE, ATTR )
+MDDL_ATTR_OP_IMPL( OP_LA, MULTIPLY, ATTR, VALUE, ATTR )
 {
     DataRef v = lhs.move();
-    v.get().multiply_value( lhs.attr, v.start, v.length(), rhs.value );
+    multiply_value_k<M1>( v.get(), lhs.attr, v.start(), v.length(), rhs.value );
     return v;
 }
 
-MDDL_OP_IMPL( OP_LA, MULTIPLY, VATTR, VSEQ, VATTR )
+MDDL_ATTR_OP_IMPL( OP_LA, MULTIPLY, VATTR, VSEQ, VATTR )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().multiply( lhs.attr, lhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    multiply_k<M1, M2>( v.get(), lhs.attr, lhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_LA, MULTIPLY, VATTR, VATTR, VATTR )
+MDDL_ATTR_OP_IMPL( OP_LA, MULTIPLY, VATTR, VATTR, VATTR )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().multiply( lhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    multiply_k<M1, M2>( v.get(), lhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_LA, MULTIPLY, VATTR, VALUE, VATTR )
+MDDL_ATTR_OP_IMPL( OP_LA, MULTIPLY, VATTR, VALUE, VATTR )
 {
     DataRef v = lhs.elide_copy();
-    v.get().multiply_value( lhs.attr, v.start, v.get().size, rhs.value );
+    multiply_value_k<M1>( v.get(), lhs.attr, v.start(), v.get().size, rhs.value );
     return v;
 }
 
@@ -1031,12 +1097,12 @@ MDDL_OP_IMPL( OP_TI, DIVIDE, SEQ, VSEQ, SEQ )
         v.get().expect( rhs.length() );
     }
 
-    v.get().divide( v.start, rhs.get(), rhs.start, rhs.length() );
+    v.get().divide( v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_TI, DIVIDE, SEQ, VATTR, SEQ )
+MDDL_ATTR_OP_IMPL( OP_TI, DIVIDE, SEQ, VATTR, SEQ )
 {
     DataRef v = lhs.move();
     
@@ -1046,7 +1112,7 @@ MDDL_OP_IMPL( OP_TI, DIVIDE, SEQ, VATTR, SEQ )
         v.get().expect( rhs.length() );
     }
 
-    v.get().divide( rhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    divide_k<M1, M2>( v.get(), rhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -1065,16 +1131,16 @@ MDDL_OP_IMPL( OP_TI, DIVIDE, VSEQ, VSEQ, VSEQ )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().divide( v.start, rhs.get(), rhs.start, rhs.length() );
+    v.get().divide( v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_TI, DIVIDE, VSEQ, VATTR, VSEQ )
+MDDL_ATTR_OP_IMPL( OP_TI, DIVIDE, VSEQ, VATTR, VSEQ )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().divide( rhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    divide_k<M1, M2>( v.get(), rhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
@@ -1086,7 +1152,7 @@ MDDL_OP_IMPL( OP_TI, DIVIDE, VSEQ, VALUE, VSEQ )
     return v;
 }
 
-MDDL_OP_IMPL( OP_TI, DIVIDE, ATTR, VSEQ, ATTR )
+MDDL_ATTR_OP_IMPL( OP_TI, DIVIDE, ATTR, VSEQ, ATTR )
 {
     DataRef v = lhs.move();
     
@@ -1096,12 +1162,12 @@ MDDL_OP_IMPL( OP_TI, DIVIDE, ATTR, VSEQ, ATTR )
         v.get().expect( rhs.length() );
     }
 
-    v.get().divide( lhs.attr, lhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    divide_k<M1, M2>( v.get(), lhs.attr, lhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_TI, DIVIDE, ATTR, VATTR, ATTR )
+MDDL_ATTR_OP_IMPL( OP_TI, DIVIDE, ATTR, VATTR, ATTR )
 {
     DataRef v = lhs.move();
     
@@ -1111,40 +1177,40 @@ MDDL_OP_IMPL( OP_TI, DIVIDE, ATTR, VATTR, ATTR )
         v.get().expect( rhs.length() );
     }
 
-    v.get().divide( lhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    divide_k<M1, M2>( v.get(), lhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_TI, DIVIDE, ATTR, VALUE, ATTR )
+MDDL_ATTR_OP_IMPL( OP_TI, DIVIDE, ATTR, VALUE, ATTR )
 {
     DataRef v = lhs.move();
-    v.get().divide_value( lhs.attr, v.start, v.length(), rhs.value );
+    divide_value_k<M1>( v.get(), lhs.attr, v.start(), v.length(), rhs.value );
     return v;
 }
 
-MDDL_OP_IMPL( OP_TI, DIVIDE, VATTR, VSEQ, VATTR )
+MDDL_ATTR_OP_IMPL( OP_TI, DIVIDE, VATTR, VSEQ, VATTR )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().divide( lhs.attr, lhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    divide_k<M1, M2>( v.get(), lhs.attr, lhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_TI, DIVIDE, VATTR, VATTR, VATTR )
+MDDL_ATTR_OP_IMPL( OP_TI, DIVIDE, VATTR, VATTR, VATTR )
 {
     DataRef v = lhs.elide_copy();
     v.get().expect( rhs.length() );
-    v.get().divide( lhs.attr, rhs.attr, v.start, rhs.get(), rhs.start, rhs.length() );
+    divide_k<M1, M2>( v.get(), lhs.attr, rhs.attr, v.start(), rhs.get(), rhs.start(), rhs.length() );
     rhs.release();
     return v;
 }
 
-MDDL_OP_IMPL( OP_TI, DIVIDE, VATTR, VALUE, VATTR )
+MDDL_ATTR_OP_IMPL( OP_TI, DIVIDE, VATTR, VALUE, VATTR )
 {
     DataRef v = lhs.elide_copy();
-    v.get().divide_value( lhs.attr, v.start, v.get().size, rhs.value );
+    divide_value_k<M1>( v.get(), lhs.attr, v.start(), v.get().size, rhs.value );
     return v;
 }
 
@@ -1158,14 +1224,14 @@ MDDL_OP_IMPL( OP_TI, DIVIDE, VALUE, VALUE, VALUE )
 // IEF
 MDDL_OP_IMPL( IEF_PLAY, "IEF_PLAY", VSEQ, NONE, VOID )
 {
-    rt->scheduler->add_sequence( lhs.get(), lhs.start, lhs.length() );
+    rt->scheduler->add_sequence( lhs.get(), lhs.start(), lhs.length() );
     lhs.release();
     return DataType::VOID;
 }
 
 MDDL_OP_IMPL( IEF_NOTE_ON, "IEF_NOTE_ON", VSEQ, NONE, VOID )
 {
-    const Sequence::Elem e = lhs.get().at( lhs.start );
+    const Sequence::Elem e = lhs.get().at( lhs.start() );
     rt->scheduler->note_on( e.pitch, e.vel );
     lhs.release();
     return DataType::VOID;
@@ -1173,7 +1239,7 @@ MDDL_OP_IMPL( IEF_NOTE_ON, "IEF_NOTE_ON", VSEQ, NONE, VOID )
 
 MDDL_OP_IMPL( IEF_NOTE_OFF, "IEF_NOTE_OFF", VSEQ, NONE, VOID )
 {
-    const Sequence::Elem e = lhs.get().at( lhs.start );
+    const Sequence::Elem e = lhs.get().at( lhs.start() );
     rt->scheduler->note_off( e.pitch );
     lhs.release();
     return DataType::VOID;
@@ -1194,15 +1260,8 @@ MDDL_OP_IMPL( IEF_PRINT, "IEF_PRINT", VSEQ, NONE, VOID )
 
     const Sequence& seq = lhs.get();
 
-    if ( seq.compressed ) {
-        std::cout << std::string( lhs.length(), (char )seq.comp.pitch );
-    } else {
-        const std::vector<Sequence::Elem> data = seq.get_data();
-        auto start = data.cbegin() + lhs.start;
-        auto end = start + lhs.length();
-        for ( auto itr = start; itr < end; itr ++ )
-            std::cout << (char )itr->pitch;
-    }
+    for ( Sequence::Cursor c( seq, lhs.start(), lhs.length() ); !c.done(); c.next() )
+        std::cout << (char )c.get().pitch;
 
     lhs.release();
     return DataType::VOID;
@@ -1218,17 +1277,73 @@ MDDL_OP_IMPL( IEF_PRINTD, "IEF_PRINTD", VSEQ, NONE, VOID )
 
 MDDL_OP_IMPL( IEF_RECORDING, "IEF_RECORDING", SEQ, NONE, VALUE )
 {
-    const bool recording = !lhs.get().complete;
+    const bool recording = lhs.get().recording();
     lhs.release();
     return (int64_t )recording;
 }
 
+MDDL_OP_IMPL( IEF_STATS, "IEF_STATS", VSEQ, NONE, VALUE )
+{
+    MemStats::global.print( std::cout );
+    if ( MemStats::scope != nullptr && MemStats::scope != &MemStats::global ) {
+        std::cout << "scope ";
+        MemStats::scope->print( std::cout );
+    }
+
+    lhs.release();
+    return MemStats::global.footprint();
+}
+
+
+// [lhs attr][rhs attr], an operand that isn't an attr is left at ALL
+// and the op reads the other operand's attr member for it
+template <bool lhs_attr, bool rhs_attr, typename F>
+static constexpr AttrFns make_attr_fns( F f )
+{
+    AttrFns attr_fns;
+
+    const auto set = [&]<int L, int R>() {
+        attr_fns.fns[L][R] = f.template operator()<attr_member<L ? L : R>(), attr_member<R ? R : L>()>();
+    };
+
+    [&]<size_t... I>( std::index_sequence<I...> ) {
+        ( set.template operator()<lhs_attr ? (int )I / 4 + 1 : 0, rhs_attr ? (int )I % 4 + 1 : 0>(), ... );
+    }( std::make_index_sequence<16>() );
+
+    return attr_fns;
+}
+
+#define MDDL_ATTR_FNS( group, lhs_t, rhs_t ) \
+    attr_fns_ ## group ## _ ## lhs_t ## _ ## rhs_t
+
+#define MDDL_ATTR_FNS_DEF( group, lhs_t, rhs_t ) \
+    static constexpr AttrFns MDDL_ATTR_FNS( group, lhs_t, rhs_t ) \
+        = make_attr_fns<is_attr_type( DataType::lhs_t ), is_attr_type( DataType::rhs_t )>( \
+            []<auto M1, auto M2>() -> OpFn { return &MDDL_OP_FN( group, lhs_t, rhs_t )<M1, M2>; } );
+
+#define MDDL_ATTR_FNS_GROUP( group ) \
+    MDDL_ATTR_FNS_DEF( group, SEQ, VATTR ) \
+    MDDL_ATTR_FNS_DEF( group, VSEQ, VATTR ) \
+    MDDL_ATTR_FNS_DEF( group, ATTR, VSEQ ) \
+    MDDL_ATTR_FNS_DEF( group, ATTR, VATTR ) \
+    MDDL_ATTR_FNS_DEF( group, ATTR, VALUE ) \
+    MDDL_ATTR_FNS_DEF( group, VATTR, VSEQ ) \
+    MDDL_ATTR_FNS_DEF( group, VATTR, VATTR ) \
+    MDDL_ATTR_FNS_DEF( group, VATTR, VALUE )
+
+MDDL_ATTR_FNS_GROUP( OP_FA )
+MDDL_ATTR_FNS_GROUP( OP_SO )
+MDDL_ATTR_FNS_GROUP( OP_LA )
+MDDL_ATTR_FNS_GROUP( OP_TI )
 
 #define MDDL_OP_REGISTER( group, name, lhs_t, rhs_t, return_t ) \
-    { OpBookKey( group, DataType::lhs_t, DataType::rhs_t ), \
-      OpBookEntry( name, MDDL_OP_FN( group, lhs_t, rhs_t ), DataType::return_t ) }
+    { group, DataType::lhs_t, DataType::rhs_t, name, MDDL_OP_FN( group, lhs_t, rhs_t ), DataType::return_t }
+
+#define MDDL_ATTR_OP_REGISTER( group, name, lhs_t, rhs_t, return_t ) \
+    { group, DataType::lhs_t, DataType::rhs_t, name, &MDDL_OP_FN( group, lhs_t, rhs_t )<>, DataType::return_t, \
+        &MDDL_ATTR_FNS( group, lhs_t, rhs_t ) }
 
-OpBook op_book = {
+static constexpr OpBookEntry OP_BOOK[] = {
     // DO, or NEW/ASSIGN
     MDDL_OP_REGISTER( OP_DO, NEW, VSEQ, NONE, VSEQ ),
     MDDL_OP_REGISTER( OP_DO, NEW, VALUE, NONE, VSEQ ),
@@ -1292,17 +1407,17 @@ OpBook op_book = {
     MDDL_OP_REGISTER( OP_FA, PITCH, VSEQ, NONE, VATTR ),
     MDDL_OP_REGISTER( OP_FA, ADD, VALUE, NONE, VALUE ),
     MDDL_OP_REGISTER( OP_FA, ADD, SEQ, VSEQ, SEQ ),
-    MDDL_OP_REGISTER( OP_FA, ADD, SEQ, VATTR, SEQ ),
+    MDDL_ATTR_OP_REGISTER( OP_FA, ADD, SEQ, VATTR, SEQ ),
     MDDL_OP_REGISTER( OP_FA, ADD, SEQ, VALUE, SEQ ),
     MDDL_OP_REGISTER( OP_FA, ADD, VSEQ, VSEQ, VSEQ ),
-    MDDL_OP_REGISTER( OP_FA, ADD, VSEQ, VATTR, VSEQ ),
+    MDDL_ATTR_OP_REGISTER( OP_FA, ADD, VSEQ, VATTR, VSEQ ),
     MDDL_OP_REGISTER( OP_FA, ADD, VSEQ, VALUE, VSEQ ),
-    MDDL_OP_REGISTER( OP_FA, ADD, ATTR, VSEQ, ATTR ),
-    MDDL_OP_REGISTER( OP_FA, ADD, ATTR, VATTR, ATTR ),
-    MDDL_OP_REGISTER( OP_FA, ADD, ATTR, VALUE, ATTR ),
-    MDDL_OP_REGISTER( OP_FA, ADD, VATTR, VSEQ, VATTR ),
-    MDDL_OP_REGISTER( OP_FA, ADD, VATTR, VATTR, VATTR ),
-    MDDL_OP_REGISTER( OP_FA, ADD, VATTR, VALUE, VATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_FA, ADD, ATTR, VSEQ, ATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_FA, ADD, ATTR, VATTR, ATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_FA, ADD, ATTR, VALUE, ATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_FA, ADD, VATTR, VSEQ, VATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_FA, ADD, VATTR, VATTR, VATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_FA, ADD, VATTR, VALUE, VATTR ),
     MDDL_OP_REGISTER( OP_FA, ADD, VALUE, VALUE, VALUE ),
     
     // SO, or VELOCITY/SUBTRACT
@@ -1310,51 +1425,51 @@ OpBook op_book = {
     MDDL_OP_REGISTER( OP_SO, VELOCITY, VSEQ, NONE, VATTR ),
     MDDL_OP_REGISTER( OP_SO, SUBTRACT, VALUE, NONE, VALUE ),
     MDDL_OP_REGISTER( OP_SO, SUBTRACT, SEQ, VSEQ, SEQ ),
-    MDDL_OP_REGISTER( OP_SO, SUBTRACT, SEQ, VATTR, SEQ ),
+    MDDL_ATTR_OP_REGISTER( OP_SO, SUBTRACT, SEQ, VATTR, SEQ ),
     MDDL_OP_REGISTER( OP_SO, SUBTRACT, SEQ, VALUE, SEQ ),
     MDDL_OP_REGISTER( OP_SO, SUBTRACT, VSEQ, VSEQ, VSEQ ),
-    MDDL_OP_REGISTER( OP_SO, SUBTRACT, VSEQ, VATTR, VSEQ ),
+    MDDL_ATTR_OP_REGISTER( OP_SO, SUBTRACT, VSEQ, VATTR, VSEQ ),
     MDDL_OP_REGISTER( OP_SO, SUBTRACT, VSEQ, VALUE, VSEQ ),
-    MDDL_OP_REGISTER( OP_SO, SUBTRACT, ATTR, VSEQ, ATTR ),
-    MDDL_OP_REGISTER( OP_SO, SUBTRACT, ATTR, VATTR, ATTR ),
-    MDDL_OP_REGISTER( OP_SO, SUBTRACT, ATTR, VALUE, ATTR ),
-    MDDL_OP_REGISTER( OP_SO, SUBTRACT, VATTR, VSEQ, VATTR ),
-    MDDL_OP_REGISTER( OP_SO, SUBTRACT, VATTR, VATTR, VATTR ),
-    MDDL_OP_REGISTER( OP_SO, SUBTRACT, VATTR, VALUE, VATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_SO, SUBTRACT, ATTR, VSEQ, ATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_SO, SUBTRACT, ATTR, VATTR, ATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_SO, SUBTRACT, ATTR, VALUE, ATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_SO, SUBTRACT, VATTR, VSEQ, VATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_SO, SUBTRACT, VATTR, VATTR, VATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_SO, SUBTRACT, VATTR, VALUE, VATTR ),
     MDDL_OP_REGISTER( OP_SO, SUBTRACT, VALUE, VALUE, VALUE ),
     
     // LA, or DURATION/MULTIPLY
     MDDL_OP_REGISTER( OP_LA, DURATION, SEQ, NONE, ATTR ),
     MDDL_OP_REGISTER( OP_LA, DURATION, VSEQ, NONE, VATTR ),
     MDDL_OP_REGISTER( OP_LA, MULTIPLY, SEQ, VSEQ, SEQ ),
-    MDDL_OP_REGISTER( OP_LA, MULTIPLY, SEQ, VATTR, SEQ ),
+    MDDL_ATTR_OP_REGISTER( OP_LA, MULTIPLY, SEQ, VATTR, SEQ ),
     MDDL_OP_REGISTER( OP_LA, MULTIPLY, SEQ, VALUE, SEQ ),
     MDDL_OP_REGISTER( OP_LA, MULTIPLY, VSEQ, VSEQ, VSEQ ),
-    MDDL_OP_REGISTER( OP_LA, MULTIPLY, VSEQ, VATTR, VSEQ ),
+    MDDL_ATTR_OP_REGISTER( OP_LA, MULTIPLY, VSEQ, VATTR, VSEQ ),
     MDDL_OP_REGISTER( OP_LA, MULTIPLY, VSEQ, VALUE, VSEQ ),
-    MDDL_OP_REGISTER( OP_LA, MULTIPLY, ATTR, VSEQ, ATTR ),
-    MDDL_OP_REGISTER( OP_LA, MULTIPLY, ATTR, VATTR, ATTR ),
-    MDDL_OP_REGISTER( OP_LA, MULTIPLY, ATTR, VALUE, ATTR ),
-    MDDL_OP_REGISTER( OP_LA, MULTIPLY, VATTR, VSEQ, VATTR ),
-    MDDL_OP_REGISTER( OP_LA, MULTIPLY, VATTR, VATTR, VATTR ),
-    MDDL_OP_REGISTER( OP_LA, MULTIPLY, VATTR, VALUE, VATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_LA, MULTIPLY, ATTR, VSEQ, ATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_LA, MULTIPLY, ATTR, VATTR, ATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_LA, MULTIPLY, ATTR, VALUE, ATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_LA, MULTIPLY, VATTR, VSEQ, VATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_LA, MULTIPLY, VATTR, VATTR, VATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_LA, MULTIPLY, VATTR, VALUE, VATTR ),
     MDDL_OP_REGISTER( OP_LA, MULTIPLY, VALUE, VALUE, VALUE ),
 
     // TI, or WAIT/DIVIDE
     MDDL_OP_REGISTER( OP_TI, WAIT, SEQ, NONE, ATTR ),
     MDDL_OP_REGISTER( OP_TI, WAIT, VSEQ, NONE, VATTR ),
     MDDL_OP_REGISTER( OP_TI, DIVIDE, SEQ, VSEQ, SEQ ),
-    MDDL_OP_REGISTER( OP_TI, DIVIDE, SEQ, VATTR, SEQ ),
+    MDDL_ATTR_OP_REGISTER( OP_TI, DIVIDE, SEQ, VATTR, SEQ ),
     MDDL_OP_REGISTER( OP_TI, DIVIDE, SEQ, VALUE, SEQ ),
     MDDL_OP_REGISTER( OP_TI, DIVIDE, VSEQ, VSEQ, VSEQ ),
-    MDDL_OP_REGISTER( OP_TI, DIVIDE, VSEQ, VATTR, VSEQ ),
+    MDDL_ATTR_OP_REGISTER( OP_TI, DIVIDE, VSEQ, VATTR, VSEQ ),
     MDDL_OP_REGISTER( OP_TI, DIVIDE, VSEQ, VALUE, VSEQ ),
-    MDDL_OP_REGISTER( OP_TI, DIVIDE, ATTR, VSEQ, ATTR ),
-    MDDL_OP_REGISTER( OP_TI, DIVIDE, ATTR, VATTR, ATTR ),
-    MDDL_OP_REGISTER( OP_TI, DIVIDE, ATTR, VALUE, ATTR ),
-    MDDL_OP_REGISTER( OP_TI, DIVIDE, VATTR, VSEQ, VATTR ),
-    MDDL_OP_REGISTER( OP_TI, DIVIDE, VATTR, VATTR, VATTR ),
-    MDDL_OP_REGISTER( OP_TI, DIVIDE, VATTR, VALUE, VATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_TI, DIVIDE, ATTR, VSEQ, ATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_TI, DIVIDE, ATTR, VATTR, ATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_TI, DIVIDE, ATTR, VALUE, ATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_TI, DIVIDE, VATTR, VSEQ, VATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_TI, DIVIDE, VATTR, VATTR, VATTR ),
+    MDDL_ATTR_OP_REGISTER( OP_TI, DIVIDE, VATTR, VALUE, VATTR ),
     MDDL_OP_REGISTER( OP_TI, DIVIDE, VALUE, VALUE, VALUE ),
 
     // IEF
@@ -1365,10 +1480,64 @@ OpBook op_book = {
     MDDL_OP_REGISTER( IEF_PRINT, "IEF_PRINT", VSEQ, NONE, VOID ),
     MDDL_OP_REGISTER( IEF_PRINTD, "IEF_PRINTD", VSEQ, NONE, VOID ),
     MDDL_OP_REGISTER( IEF_RECORDING, "IEF_RECORDING", SEQ, NONE, VALUE ),
+    MDDL_OP_REGISTER( IEF_STATS, "IEF_STATS", VSEQ, NONE, VALUE ),
 };
 
+static constexpr const OpBookEntry* find_op( OpId group, DataType lhs_t, DataType rhs_t )
+{
+    for ( const OpBookEntry& entry : OP_BOOK )
+        if ( entry.group == group && entry.lhs_t == lhs_t && entry.rhs_t == rhs_t )
+            return &entry;
+
+    return nullptr;
+}
+
+// the exact operand types first, then widening rhs, then widening lhs (against the widest rhs)
+static constexpr OpBookEntry resolve_op( OpId group, DataType lhs_t, DataType rhs_t )
+{
+    if ( const OpBookEntry* entry = find_op( group, lhs_t, rhs_t ) )
+        return *entry;
+
+    while ( has_implicit_cast( rhs_t ) ) {
+        rhs_t = implicit_cast( rhs_t );
+        if ( const OpBookEntry* entry = find_op( group, lhs_t, rhs_t ) )
+            return *entry;
+    }
+
+    while ( has_implicit_cast( lhs_t ) ) {
+        lhs_t = implicit_cast( lhs_t );
+        if ( const OpBookEntry* entry = find_op( group, lhs_t, rhs_t ) )
+            return *entry;
+    }
+
+    return {};
+}
+
+static constexpr OpTable make_op_table()
+{
+    OpTable table;
+
+    for ( const OpBookEntry& entry : OP_BOOK ) {
+        const int g = op_group_index( entry.group );
+        for ( int l = 0; l < N_DATA_TYPES; l ++ )
+            for ( int r = 0; r < N_DATA_TYPES; r ++ )
+                if ( table.entries[g][l][r].group == OP_UNKNOWN )
+                    table.entries[g][l][r] = resolve_op( entry.group, (DataType )l, (DataType )r );
+    }
+
+    return table;
+}
+
+constexpr OpTable op_table = make_op_table();
+
 #undef MDDL_OP_FN
 #undef MDDL_OP_FN_IMPL
+#undef MDDL_ATTR_OP_IMPL
+#undef MDDL_ATTR_KERNEL
+#undef MDDL_ATTR_FNS
+#undef MDDL_ATTR_FNS_DEF
+#undef MDDL_ATTR_FNS_GROUP
 #undef MDDL_OP_REGISTER
+#undef MDDL_ATTR_OP_REGISTER
 
 } // namespace MDDL
\ No newline at end of file
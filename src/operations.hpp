@@ -8,9 +8,6 @@
 #include "utils.hpp"
 
 #include <cstdint>
-#include <functional>
-#include <map>
-#include <string>
 
 
 
@@ -18,51 +15,54 @@ namespace MDDL {
 
 static constexpr int N_OP_IDS = 7;
 
-struct OpBookKey
+// dense index of an op or IEF group, N_OP_GROUPS if it has none
+constexpr int op_group_index( OpId group )
 {
-    OpBookKey( OpId group, DataType lhs_t, DataType rhs_t )
-        : group { group }
-        , lhs_t { lhs_t }
-        , rhs_t { rhs_t }
-    {}
+    if ( group >= OP_DO && group <= OP_TI )
+        return group - OP_DO;
+    if ( group >= IEF_DEFAULT && group <= IEF_STATS )
+        return N_OP_IDS + group - IEF_DEFAULT;
+    return N_OP_IDS + IEF_STATS - IEF_DEFAULT + 1;
+}
 
-    bool operator<( const OpBookKey& rhs ) const
-    {
-        if ( group < rhs.group ) return true;
-        if ( group > rhs.group ) return false;
-        if ( lhs_t < rhs.lhs_t ) return true;
-        if ( lhs_t > rhs.lhs_t ) return false;
-        return (rhs_t < rhs.rhs_t);
-    }
-
-    const OpId  group   = OP_UNKNOWN;
-    DataType    lhs_t   = DataType::UNKNOWN;
-    DataType    rhs_t   = DataType::UNKNOWN;
-};
+static constexpr int N_OP_GROUPS = op_group_index( OP_UNKNOWN );
 
 class Runtime;
-using OpFn = std::function<DataRef( Runtime*, DataRef&, DataRef& )>;
+using OpFn = DataRef (*)( Runtime*, DataRef&, DataRef& );
 
-struct OpBookEntry
+// instantiations of an op for [lhs attr][rhs attr] known at build time,
+// ALL for an operand whose attr the op doesn't read (null where there is none)
+struct AttrFns
 {
-    OpBookEntry() = default;
-
-    OpBookEntry( const char* name, OpFn fn, DataType return_t )
-        : name      { name }
-        , fn        { fn }
-        , return_t  { return_t }
-    {}
+    OpFn            fns[N_ATTR_TYPES][N_ATTR_TYPES] = {};
+};
 
+// lhs_t/rhs_t are the operand types fn is implemented for
+struct OpBookEntry
+{
+    OpId            group       = OP_UNKNOWN;
+    DataType        lhs_t       = DataType::UNKNOWN;
+    DataType        rhs_t       = DataType::UNKNOWN;
     const char*     name        = "UNKNOWN";
-    const OpFn      fn          = nullptr;
-    const DataType  return_t    = DataType::UNKNOWN;
+    OpFn            fn          = nullptr;
+    DataType        return_t    = DataType::UNKNOWN;
+    const AttrFns*  attr_fns    = nullptr;
 };
 
+// entry of every [group][lhs][rhs], with implicit casts of the operands already resolved
+// (null fn where none applies)
+struct OpTable
+{
+    const OpBookEntry& at( OpId group, DataType lhs_t, DataType rhs_t ) const
+    {
+        return entries[op_group_index( group )][(int )lhs_t][(int )rhs_t];
+    }
 
-using OpBook = std::map<OpBookKey, OpBookEntry>;
+    OpBookEntry entries[N_OP_GROUPS + 1][N_DATA_TYPES][N_DATA_TYPES] = {};
+};
 
-extern OpBook op_book;
+extern const OpTable op_table;
 
-};
+} // namespace MDDL
 
 #endif // __MDDL_OPERATIONS_HPP__
\ No newline at end of file
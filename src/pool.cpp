@@ -0,0 +1,169 @@
+// pool.cpp
+
+#include "pool.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+
+
+namespace MDDL {
+
+// slabs are aligned to their size, so a block finds its slab header by masking
+static constexpr size_t SLAB_SIZE = 64 * 1024;
+static constexpr size_t SLAB_HEADER = 16;
+
+static constexpr size_t CLASS_SIZES[] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096
+};
+
+static constexpr int N_CLASSES = sizeof( CLASS_SIZES ) / sizeof( CLASS_SIZES[0] );
+
+// size class of each 16 byte step up to POOL_MAX_BLOCK
+struct ClassTable
+{
+    constexpr ClassTable()
+    {
+        int c = 0;
+        for ( size_t i = 0; i < POOL_MAX_BLOCK / 16; i ++ ) {
+            while ( CLASS_SIZES[c] < (i + 1) * 16 )
+                c ++;
+            idx[i] = (uint8_t )c;
+        }
+    }
+
+    uint8_t idx[POOL_MAX_BLOCK / 16] = {};
+};
+
+static constexpr ClassTable CLASS_TABLE;
+
+static int size_class( size_t size )
+{
+    return CLASS_TABLE.idx[(size + 15) / 16 - 1];
+}
+
+struct Block
+{
+    Block*      next        = nullptr;
+};
+
+struct Pool;
+
+struct Slab
+{
+    Pool*       owner       = nullptr;
+};
+
+struct Pool
+{
+    void* carve( size_t size )
+    {
+        if ( bump_left < size ) {
+            // the rest of the current slab is dropped
+            bump = (char* )::operator new( SLAB_SIZE, std::align_val_t( SLAB_SIZE ) );
+            new ( bump ) Slab { this };
+            bump += SLAB_HEADER;
+            bump_left = SLAB_SIZE - SLAB_HEADER;
+        }
+
+        void* p = bump;
+        bump += size;
+        bump_left -= size;
+        return p;
+    }
+
+    Block*              free_list[N_CLASSES]    = {};
+    std::atomic<Block*> remote[N_CLASSES]       = {};
+    char*               bump                    = nullptr;
+    size_t              bump_left               = 0;
+};
+
+// pools outlive their threads, blocks may still be freed into them.
+// a finished thread's pool is taken over by the next thread that starts
+// (never destructed, threads may exit after static destructors ran)
+static std::mutex orphans_mtx;
+static std::vector<Pool*>& orphans = *new std::vector<Pool*>;
+
+static thread_local Pool* local = nullptr;
+
+struct PoolReaper
+{
+    ~PoolReaper()
+    {
+        std::lock_guard<std::mutex> lock( orphans_mtx );
+        orphans.push_back( local );
+        local = nullptr;
+    }
+};
+
+static Pool& local_pool()
+{
+    if ( local != nullptr )
+        return *local;
+
+    {
+        std::lock_guard<std::mutex> lock( orphans_mtx );
+        if ( !orphans.empty() ) {
+            local = orphans.back();
+            orphans.pop_back();
+        }
+    }
+
+    if ( local == nullptr )
+        local = new Pool;
+
+    static thread_local PoolReaper reaper;
+    (void )reaper;
+
+    return *local;
+}
+
+void* pool_alloc( size_t size )
+{
+    if ( size == 0 || size > POOL_MAX_BLOCK )
+        return ::operator new( size );
+
+    const int c = size_class( size );
+    Pool& pool = local_pool();
+
+    Block* b = pool.free_list[c];
+    if ( b == nullptr )
+        b = pool.remote[c].exchange( nullptr, std::memory_order_acquire );
+
+    if ( b == nullptr )
+        return pool.carve( CLASS_SIZES[c] );
+
+    pool.free_list[c] = b->next;
+    return b;
+}
+
+void pool_free( void* p, size_t size )
+{
+    if ( p == nullptr )
+        return;
+
+    if ( size == 0 || size > POOL_MAX_BLOCK ) {
+        ::operator delete( p );
+        return;
+    }
+
+    const int c = size_class( size );
+    Block* b = (Block* )p;
+    Pool* owner = ((Slab* )((uintptr_t )p & ~(uintptr_t )(SLAB_SIZE - 1)))->owner;
+
+    if ( owner == local ) {
+        b->next = owner->free_list[c];
+        owner->free_list[c] = b;
+        return;
+    }
+
+    // freed off the owning thread, the owner collects these once its own list runs dry
+    Block* head = owner->remote[c].load( std::memory_order_relaxed );
+    do {
+        b->next = head;
+    } while ( !owner->remote[c].compare_exchange_weak( head, b, std::memory_order_release, std::memory_order_relaxed ) );
+}
+
+} // namespace MDDL
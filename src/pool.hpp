@@ -0,0 +1,42 @@
+// pool.hpp
+// Size-classed block pool for sequences and their buffers.
+// Each thread allocates from its own pool, blocks freed by another thread
+// are handed back to the owning pool through a lock-free list.
+
+#ifndef __MDDL_POOL_HPP__
+#define __MDDL_POOL_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+
+
+namespace MDDL {
+
+// requests above this size go straight to operator new
+static constexpr size_t POOL_MAX_BLOCK = 4096;
+
+void* pool_alloc( size_t size );
+void pool_free( void* p, size_t size );
+
+template <typename T>
+struct PoolAllocator
+{
+    typedef T value_type;
+
+    PoolAllocator() = default;
+    template <typename U>
+    PoolAllocator( const PoolAllocator<U>& ) {}
+
+    T* allocate( size_t n ) { return (T* )pool_alloc( n * sizeof( T ) ); }
+    void deallocate( T* p, size_t n ) { pool_free( p, n * sizeof( T ) ); }
+
+    template <typename U>
+    bool operator==( const PoolAllocator<U>& ) const { return true; }
+    template <typename U>
+    bool operator!=( const PoolAllocator<U>& ) const { return false; }
+};
+
+} // namespace MDDL
+
+#endif // __MDDL_POOL_HPP__
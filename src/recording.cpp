@@ -0,0 +1,81 @@
+// recording.cpp
+
+#include "errors.hpp"
+#include "recording.hpp"
+
+
+
+namespace MDDL {
+
+void* Recording::Segment::operator new( size_t size )
+{
+    void* p = pool_alloc( size );
+    mem_charge_recorded( size );
+    return p;
+}
+
+void Recording::Segment::operator delete( void* p, size_t size )
+{
+    pool_free( p, size );
+    mem_release_bytes( size );
+}
+
+Recording::Recording()
+{
+    head = new Segment;
+    segments.push_back( head );
+}
+
+Recording::~Recording()
+{
+    for ( Segment* seg : segments )
+        delete seg;
+}
+
+void Recording::note_on( uint8_t pitch, uint8_t vel, int64_t wait )
+{
+    if ( length == (int64_t )segments.size() * SEGMENT_SIZE ) {
+        Segment* seg = new Segment;
+        segments.back()->next.store( seg, std::memory_order_release );
+        segments.push_back( seg );
+    }
+
+    Elem& e = at( length );
+    e.pitch = pitch;
+    e.vel = vel;
+    e.wait = wait;
+    e.dur = 0;
+
+    length ++;
+}
+
+void Recording::note_hold( int64_t idx, int64_t duration )
+{
+    sys_assert( idx >= committed() && idx < length, "Recording bounds error." );
+    at( idx ).dur += (int32_t )duration;
+}
+
+// notes before end are final
+void Recording::commit( int64_t end )
+{
+    published.store( end, std::memory_order_release );
+    published.notify_all();
+}
+
+void Recording::close()
+{
+    published.store( length | CLOSED, std::memory_order_release );
+    published.notify_all();
+}
+
+// blocks until n notes are committed or the recording is closed
+void Recording::wait( int64_t n ) const
+{
+    int64_t v = published.load( std::memory_order_acquire );
+    while ( (v & CLOSED) == 0 && v < n ) {
+        published.wait( v, std::memory_order_acquire );
+        v = published.load( std::memory_order_acquire );
+    }
+}
+
+} // namespace MDDL
@@ -0,0 +1,85 @@
+// recording.hpp
+// Append-only note buffer for a sequence literal while it is recorded.
+// The parser appends notes and extends the ones still held, everything
+// before the committed length is final and may be read from any thread.
+
+#ifndef __MDDL_RECORDING_HPP__
+#define __MDDL_RECORDING_HPP__
+
+#include "pool.hpp"
+#include "sequence.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+
+
+namespace MDDL {
+
+struct Recording
+{
+    typedef Sequence::Elem Elem;
+
+    static constexpr int64_t SEGMENT_SIZE = 256;
+
+    // set in published once no more notes follow
+    static constexpr int64_t CLOSED = (int64_t )1 << 62;
+
+    // segments never move once linked, readers follow next
+    struct Segment
+    {
+        static void* operator new( size_t size );
+        static void operator delete( void* p, size_t size );
+
+        Elem                    elems[SEGMENT_SIZE];
+        std::atomic<Segment*>   next        = nullptr;
+    };
+
+    Recording();
+    ~Recording();
+
+    // parser thread
+    void note_on( uint8_t pitch, uint8_t vel, int64_t wait );
+    void note_hold( int64_t idx, int64_t duration );
+    void commit( int64_t end );
+    void close();
+
+    Elem& at( int64_t idx ) { return segments[idx / SEGMENT_SIZE]->elems[idx % SEGMENT_SIZE]; }
+    int64_t size() const { return length; }
+
+    // any thread
+    int64_t committed() const { return published.load( std::memory_order_acquire ) & ~CLOSED; }
+    void wait( int64_t n ) const;
+    template <typename Fn>
+    void read( int64_t start, int64_t end, Fn fn ) const;
+
+    Segment*                head        = nullptr;
+    std::vector<Segment*>   segments    = {};   // parser's index of the segments
+    int64_t                 length      = 0;
+    std::atomic<int64_t>    published   = 0;
+    int64_t                 synced      = 0;    // committed notes already taken by the sequence
+};
+
+// fn( elem ) for each elem in [start, end), end <= committed()
+template <typename Fn>
+void Recording::read( int64_t start, int64_t end, Fn fn ) const
+{
+    if ( start >= end )
+        return;
+
+    const Segment* seg = head;
+    for ( int64_t n = start / SEGMENT_SIZE; n > 0; n -- )
+        seg = seg->next.load( std::memory_order_acquire );
+
+    for ( int64_t i = start; i < end; i ++ ) {
+        if ( i != start && i % SEGMENT_SIZE == 0 )
+            seg = seg->next.load( std::memory_order_acquire );
+
+        fn( seg->elems[i % SEGMENT_SIZE] );
+    }
+}
+
+} // namespace MDDL
+
+#endif // __MDDL_RECORDING_HPP__
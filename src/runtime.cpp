@@ -41,29 +41,222 @@ DataRef Runtime::execute( const ExprRoot* node )
     return return_v;
 }
 
+// runs the roots of scope from entry, its frame must be on the stack.
+// nothing else holds temporaries once the outermost run returns,
+// its result is moved out and the arena starts over
+DataRef Runtime::execute_root( const Scope* scope, const ExprRoot* entry )
+{
+    const bool outermost = (root_depth ++ == 0);
+
+    DataRef v;
+    try {
+        if ( mode == Mode::TREE ) {
+            v = execute( entry );
+        } else {
+            const Bytecode& code = compiled( scope );
+            v = run( code, code.entry( entry ) );
+        }
+    } catch ( ... ) {
+        // temporaries the tree walker dropped while unwinding are never released,
+        // their space stays taken and allocation falls back to the pool when full
+        if ( -- root_depth == 0 )
+            arena.rewind();
+        throw;
+    }
+
+    root_depth --;
+    if ( outermost ) {
+        v = promote( v );
+        arena.reset();
+    }
+
+    return v;
+}
+
 DataRef Runtime::execute_scope( const Scope* scope )
 {
+    MemStatsScope charged( &scope->stats );
     push_scope( scope );
 
-    const ExprRoot* node = scope->head;
-    const DataRef v = execute( node ).cast_to_vseq();
+    const DataRef v = execute_root( scope, scope->head ).cast_to_vseq();
 
     pop_scope( scope );
     return v;
 }
 
+const Bytecode& Runtime::compiled( const Scope* scope )
+{
+    if ( scope->code == nullptr || !scope->code->current( scope ) ) {
+        delete scope->code;
+        scope->code = new Bytecode( scope );
+    }
+
+    return *scope->code;
+}
+
+// calls run in this loop on frames saved to the heap, the native stack doesn't grow with recursion
+DataRef Runtime::run( const Bytecode& entry_code, int32_t pc )
+{
+    const Bytecode* code = &entry_code;
+    const Scope* scope = nullptr;
+    const size_t frame_base = frames.size();
+    size_t base = operands.size();
+    DataRef held( DataType::UNDEFINED );
+
+    const auto pop = [this]() {
+        const DataRef v = operands.back();
+        operands.pop_back();
+        return v;
+    };
+
+    // the args are on top of the operands, a tail call replaces the current frame
+    const auto enter = [&]( const FunctionCallExpr* fn_expr, bool tail ) {
+        const Scope* callee = fn_expr->scope;
+        rt_assert( callee != nullptr, "Function definition for " + fn_expr->to_string() + " not found." );
+        sys_assert( fn_expr->children.size() == callee->args.size() );
+
+        const int n_args = (int )fn_expr->children.size();
+        if ( tail ) {
+            // args hold their own refs, the frame can go first
+            held.release();
+            pop_scope( scope );
+        } else {
+            // the caller's temporaries would pin the arena for the whole call
+            for ( size_t i = base; i < operands.size() - n_args; i ++ )
+                operands[i] = promote( operands[i] );
+            held = promote( held );
+
+            frames.push_back( { code, pc, scope, stack_pos, base, held, MemStats::scope } );
+        }
+
+        scope = callee;
+        code = &compiled( callee );
+        pc = code->entry( callee->head );
+        stack_pos = (int )stack.size();
+        base = operands.size() - n_args;
+        held = DataType::UNDEFINED;
+        MemStats::scope = &callee->stats;
+
+        for ( size_t i = base; i < operands.size(); i ++ ) {
+            push_to_stack( operands[i] );
+            operands[i] = DataRef();
+        }
+
+        operands.resize( base );
+        push_scope( callee );
+    };
+
+    try {
+        for ( ;; ) {
+            const Instr& in = code->instrs[pc ++];
+
+            switch ( in.code ) {
+                case Instr::PUSH_VALUE:
+                    operands.push_back( in.value );
+                    break;
+                case Instr::PUSH_TYPE:
+                    operands.push_back( in.type );
+                    break;
+                case Instr::PUSH_SEQ_LIT:
+                    operands.push_back( process_sequence_literal( in.seq_expr ) );
+                    break;
+                case Instr::LOAD_VAR:
+                    operands.push_back( process_variable( in.var_expr ) );
+                    break;
+                case Instr::CAST_SEQ:
+                    operands.back() = operands.back().cast_to_seq();
+                    break;
+                case Instr::OP: {
+                    DataRef rhs = pop();
+                    DataRef lhs = pop();
+                    operands.push_back( apply_operation( in.op_expr, lhs, rhs ) );
+                    break;
+                }
+                case Instr::CALL:
+                    enter( in.fn_expr, false );
+                    break;
+                case Instr::TAIL_CALL:
+                    // the entry frame belongs to the caller of run
+                    enter( in.fn_expr, frames.size() > frame_base );
+                    break;
+                case Instr::RELEASE:
+                    held.release();
+                    break;
+                case Instr::HOLD:
+                    held = pop();
+                    break;
+                case Instr::JUMP:
+                    pc = in.target;
+                    break;
+                case Instr::BRANCH: {
+                    const DataRef v = pop();
+                    assert( v.type == DataType::VALUE );
+                    pc = (v.value > 0) ? in.target : in.alt;
+                    break;
+                }
+                case Instr::END: {
+                    sys_assert( operands.size() == base );
+                    if ( frames.size() == frame_base )
+                        return held;
+
+                    const DataRef v = held.cast_to_vseq();
+                    pop_scope( scope );
+
+                    const Frame& caller = frames.back();
+                    code = caller.code;
+                    pc = caller.pc;
+                    scope = caller.scope;
+                    stack_pos = caller.stack_pos;
+                    base = caller.base;
+                    held = caller.held;
+                    MemStats::scope = caller.charged;
+                    frames.pop_back();
+
+                    operands.push_back( v );
+                    break;
+                }
+            }
+        }
+    } catch ( ... ) {
+        while ( operands.size() > base )
+            operands.back().release(), operands.pop_back();
+        held.release();
+
+        // unwind the calls made in this loop, a frame may be left partly pushed
+        while ( frames.size() > frame_base ) {
+            for ( int i = stack_pos; i < (int )stack.size(); i ++ )
+                stack[i].release();
+            stack.resize( stack_pos );
+
+            Frame& caller = frames.back();
+            scope = caller.scope;
+            stack_pos = caller.stack_pos;
+            base = caller.base;
+            MemStats::scope = caller.charged;
+            caller.held.release();
+            frames.pop_back();
+
+            while ( operands.size() > base )
+                operands.back().release(), operands.pop_back();
+        }
+
+        throw;
+    }
+}
+
 void Runtime::push_scope( const Scope* scope )
 {
-    // stack already has scope args initialized /after/ stack pos
-    const int stack_target = stack_pos + (int )scope->vars.size();
-    while ( (int )stack.size() < stack_target )
-        push_to_stack( DataRef( DataType::SEQ, new Sequence ) );
+    // stack already has scope args initialized /after/ stack pos,
+    // locals are left empty until first read (see process_variable)
+    const int stack_target = stack_pos + scope->get_frame_size();
+    if ( (int )stack.size() < stack_target )
+        stack.resize( stack_target );
 }
 
 void Runtime::pop_scope( const Scope* scope )
 {
     const int stack_start = stack_pos;
-    const int stack_end = stack_pos + (int )scope->vars.size();
+    const int stack_end = stack_pos + scope->get_frame_size();
     for ( int i = stack_start; i < stack_end; i ++ )
         stack[i].release();
     
@@ -73,8 +266,24 @@ void Runtime::pop_scope( const Scope* scope )
 void Runtime::push_to_stack( const DataRef& ref )
 {
     const int64_t top = (int64_t )stack.size();
-    stack.push_back( ref );
-    stack.back().stack_pos = top;
+    stack.push_back( promote( ref ) );
+    stack.back().stack_pos = (int32_t )top;
+}
+
+// moves a temporary out of the arena before it outlives the root
+DataRef Runtime::promote( DataRef ref )
+{
+    if ( ref.empty() || !arena.owns( ref.get_ref() ) )
+        return ref;
+
+    // placed in the pool directly, the arena may still be enabled
+    const Sequence& seq = ref.get();
+    DataRef v( ref.type, ::new ( pool_alloc( sizeof( Sequence ) ) ) Sequence( seq, 0, seq.size ), ref.attr );
+    if ( ref.is_subseq() )
+        v.set_range( ref.start(), ref.size() );
+    v.stack_pos = ref.stack_pos;
+    ref.release();
+    return v;
 }
 
 std::pair<DataRef, ExprRoot*> Runtime::process_root( const ExprRoot* root )
@@ -133,15 +342,25 @@ DataRef Runtime::process_expr( const Expr* expr )
 DataRef Runtime::process_function_call( const FunctionCallExpr* fn_expr )
 {
     //std::cout << "SCOPE " << fn_expr->to_string() << "\n";
-    const int curr_stack_pos = stack_pos;
     const int child_stack_pos = (int )stack.size();
     
     rt_assert( fn_expr->scope != nullptr, "Function definition for " + fn_expr->to_string() + " not found." );
-    sys_assert( fn_expr->children.size() == fn_expr->scope->args.size() );
 
     for ( const Expr* child : fn_expr->children )
         push_to_stack( process_expr( child ).cast_to_seq() );
 
+    return call( fn_expr, child_stack_pos );
+}
+
+// the args are already pushed from child_stack_pos.
+// calls of the tree walker recurse, the bytecode makes them in its own loop (see run)
+DataRef Runtime::call( const FunctionCallExpr* fn_expr, int child_stack_pos )
+{
+    rt_assert( fn_expr->scope != nullptr, "Function definition for " + fn_expr->to_string() + " not found." );
+    sys_assert( fn_expr->children.size() == fn_expr->scope->args.size() );
+
+    const int curr_stack_pos = stack_pos;
+
     stack_pos = child_stack_pos;
     const DataRef& v = execute_scope( fn_expr->scope );
     stack_pos = curr_stack_pos;
@@ -154,14 +373,25 @@ DataRef Runtime::process_operation( const OperationExpr* op_expr )
     DataRef lhs = process_expr( op_expr->child_lhs );
     DataRef rhs = (op_expr->child_rhs == nullptr) ? DataType::NONE : process_expr( op_expr->child_rhs );
 
+    return apply_operation( op_expr, lhs, rhs );
+}
+
+DataRef Runtime::apply_operation( const OperationExpr* op_expr, DataRef& lhs, DataRef& rhs )
+{
     lhs.implicit_cast( op_expr->lhs_type );
     rhs.implicit_cast( op_expr->rhs_type );
 
-    std::mutex lhs_dummy, rhs_dummy;
-    std::lock_guard<std::mutex> lhs_guard( lhs.empty() || lhs.get().ref_count == 1 ? lhs_dummy : lhs.mtx() );
-    std::lock_guard<std::mutex> rhs_guard( rhs.empty() || rhs.get().ref_count == 1 ? rhs_dummy : rhs.mtx() );
+    // literals being recorded take the notes committed so far
+    if ( !lhs.empty() )
+        lhs.get().sync();
+    if ( !rhs.empty() )
+        rhs.get().sync();
 
-    DataRef v = op_expr->fn( this, lhs, rhs );
+    DataRef v;
+    {
+        ArenaScope temps( arena );
+        v = op_expr->fn( this, lhs, rhs );
+    }
 
     sys_assert( v.type == op_expr->return_type );
     // v.implicit_cast( op_expr->return_type );
@@ -174,7 +404,15 @@ DataRef Runtime::process_operation( const OperationExpr* op_expr )
 
 DataRef Runtime::process_variable( const VariableExpr* var_expr )
 {
-    return stack[stack_pos + var_expr->stack_offset].duplicate();
+    const int slot = stack_pos + var_expr->stack_offset;
+    DataRef& var = stack[slot];
+
+    if ( var.empty() ) {
+        var = DataRef( DataType::SEQ, new Sequence );
+        var.stack_pos = slot;
+    }
+
+    return var_expr->last_use ? var.move() : var.duplicate();
 }
 
 DataRef Runtime::process_value_literal( const ValueLiteralExpr* val_expr )
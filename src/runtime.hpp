@@ -1,8 +1,10 @@
-// environment.hpp
+// runtime.hpp
 
 #ifndef __MDDL_RUNTIME_HPP__
 #define __MDDL_RUNTIME_HPP__
 
+#include "arena.hpp"
+#include "bytecode.hpp"
 #include "environment.hpp"
 #include "data_ref.hpp"
 #include "scheduler.hpp"
@@ -15,28 +17,61 @@ namespace MDDL {
 class Runtime
 {
 public:
+    // the tree walker is kept as the reference for the bytecode
+    enum class Mode
+    {
+        BYTECODE, TREE
+    };
+
     Runtime( Scheduler* scheduler )
         : scheduler { scheduler }
     {}
 
     DataRef execute( const ExprRoot* node );
+    DataRef execute_root( const Scope* scope, const ExprRoot* entry );
     DataRef execute_scope( const Scope* scope );
 
+    const Bytecode& compiled( const Scope* scope );
+    DataRef run( const Bytecode& code, int32_t pc );
+
     void push_scope( const Scope* scope );
     void pop_scope( const Scope* scope );
     void push_to_stack( const DataRef& ref );
+    DataRef promote( DataRef ref );
 
     std::pair<DataRef, ExprRoot*> process_root( const ExprRoot* root );
     DataRef process_expr( const Expr* expr );
     DataRef process_function_call( const FunctionCallExpr* fn_expr );
+    DataRef call( const FunctionCallExpr* fn_expr, int child_stack_pos );
     DataRef process_operation( const OperationExpr* op_expr );
+    DataRef apply_operation( const OperationExpr* op_expr, DataRef& lhs, DataRef& rhs );
     DataRef process_variable( const VariableExpr* var_expr );
     DataRef process_value_literal( const ValueLiteralExpr* val_expr );
     DataRef process_sequence_literal( const SequenceLiteralExpr* seq_expr );
 
+    // op results are allocated here until they are stored to the stack
+    static constexpr size_t ARENA_SIZE = 256 * 1024;
+
+    // the caller's state, saved while a call runs in the same dispatch loop
+    struct Frame
+    {
+        const Bytecode*     code        = nullptr;
+        int32_t             pc          = 0;
+        const Scope*        scope       = nullptr;
+        int                 stack_pos   = 0;
+        size_t              base        = 0;
+        DataRef             held        = {};
+        MemStats*           charged     = nullptr;
+    };
+
     Scheduler* scheduler    = nullptr;
+    Arena arena             = ARENA_SIZE;
+    Mode mode               = Mode::BYTECODE;
     std::vector<DataRef> stack;
+    std::vector<DataRef> operands;
+    std::vector<Frame> frames;
     int stack_pos = 0;
+    int root_depth = 0;
 };
 
 } // namespace MDDL
@@ -1,5 +1,6 @@
 // scheduler.cpp
 
+#include "errors.hpp"
 #include "scheduler.hpp"
 
 namespace MDDL {
@@ -56,32 +57,31 @@ void Scheduler::thread_run()
     }
 }
 
+// the notes are copied out on the exec thread, the scheduler thread never reads seq
 void Scheduler::add_sequence( Sequence& seq, int64_t start, int64_t length )
 {
+    sys_assert( std::this_thread::get_id() != thread.get_id() );
+    seq.flush();
 
     std::lock_guard<std::mutex> guard( outgoing_mtx );
 
-    if ( seq.compressed && seq.comp.vel == 0 )
+    if ( seq.silent() )
         return;
 
-    const std::vector<Note>& data = seq.get_data();
-
     auto search = outgoing.begin(); // insert search start
-    
-    auto data_start = data.cbegin() + start;
-    auto data_end = data_start + length;
 
-    for ( auto itr = data_start; itr < data_end; itr ++ ) {
-        if ( itr->vel == 0 )
+    for ( Sequence::Cursor c( seq, start, length ); !c.done(); c.next() ) {
+        const Note note = c.get();
+        if ( note.vel == 0 )
             continue;
 
         Event e;
-        e.pitch = itr->pitch;
-        e.vel = itr->vel;
-        e.wait = (int64_t )(itr->wait * ticks_to_ns);
+        e.pitch = note.pitch;
+        e.vel = note.vel;
+        e.wait = (int64_t )(note.wait * ticks_to_ns);
         search = insert_event( e, search );
 
-        e.wait = (int64_t )(itr->dur * ticks_to_ns);
+        e.wait = (int64_t )(note.dur * ticks_to_ns);
         e.vel = 0;
         insert_event( e, std::next( search ) );
         search ++;
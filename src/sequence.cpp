@@ -1,7 +1,14 @@
 // sequence.cpp
 
+#include "arena.hpp"
 #include "errors.hpp"
+#include "intern.hpp"
+#include "kernels.hpp"
+#include "recording.hpp"
 #include "sequence.hpp"
+#include "stats.hpp"
+
+#include <limits>
 
 
 
@@ -117,387 +124,1169 @@ void Elem::operator/=( const Elem& rhs )
 }
 
 
+using Data = Sequence::Data;
 
-Sequence::Sequence()
-    : Sequence( 0 )
-{};
-
-Sequence::Sequence( int64_t value )
-    : size          { value }
-    , compressed    { true }
+Data::Data( const Data& rhs, int64_t rhs_start, int64_t rhs_length )
+    : pitch ( rhs.pitch.cbegin() + rhs_start, rhs.pitch.cbegin() + rhs_start + rhs_length )
+    , vel   ( rhs.vel.cbegin() + rhs_start, rhs.vel.cbegin() + rhs_start + rhs_length )
+    , dur   ( rhs.dur.cbegin() + rhs_start, rhs.dur.cbegin() + rhs_start + rhs_length )
+    , wait  ( rhs.wait.cbegin() + rhs_start, rhs.wait.cbegin() + rhs_start + rhs_length )
 {}
 
-Sequence::Sequence( const Elem& elem, int64_t size )
-    : comp          { elem }
-    , size          { size }
-    , compressed    { true }
-{}
+Elem Data::get( int64_t idx ) const
+{
+    Elem e;
+    e.pitch = pitch[idx];
+    e.vel = vel[idx];
+    e.dur = dur[idx];
+    e.wait = wait[idx];
+    return e;
+}
 
-Sequence::Sequence( const Sequence& rhs, int64_t rhs_start, int64_t rhs_length )
-    : size          { rhs_length }
-    , compressed    { rhs.compressed }
+void Data::push_back( const Elem& elem )
 {
-    if ( compressed ) {
-        comp = rhs.comp;
-    } else {
-        const auto rd_start = rhs.data.cbegin() + rhs_start;
-        const auto rd_end = rd_start + rhs_length;
-        data = Data( rd_start, rd_end );
-    }
+    pitch.push_back( elem.pitch );
+    vel.push_back( elem.vel );
+    dur.push_back( elem.dur );
+    wait.push_back( elem.wait );
 }
 
-void Sequence::note_on( uint8_t pitch, uint8_t vel, int64_t wait )
+void Data::resize( int64_t size )
 {
-    Elem e;
-    e.pitch = pitch;
-    e.vel = vel;
-    e.wait = wait;
-    e.dur = 0;
+    pitch.resize( size );
+    vel.resize( size );
+    dur.resize( size );
+    wait.resize( size );
+}
 
-    if ( compressed )
-        expand();
+void Data::reserve( int64_t size )
+{
+    pitch.reserve( size );
+    vel.reserve( size );
+    dur.reserve( size );
+    wait.reserve( size );
+}
 
-    data.push_back( e );
-    size ++;
+void Data::fill( int64_t start, int64_t length, const Elem& elem )
+{
+    std::fill_n( pitch.begin() + start, length, elem.pitch );
+    std::fill_n( vel.begin() + start, length, elem.vel );
+    std::fill_n( dur.begin() + start, length, elem.dur );
+    std::fill_n( wait.begin() + start, length, elem.wait );
 }
 
-void Sequence::note_hold( int64_t idx, int64_t duration )
+void Data::copy( int64_t start, const Data& rhs, int64_t rhs_start, int64_t length )
 {
-    at( idx ).dur += duration;
+    std::copy_n( rhs.pitch.cbegin() + rhs_start, length, pitch.begin() + start );
+    std::copy_n( rhs.vel.cbegin() + rhs_start, length, vel.begin() + start );
+    std::copy_n( rhs.dur.cbegin() + rhs_start, length, dur.begin() + start );
+    std::copy_n( rhs.wait.cbegin() + rhs_start, length, wait.begin() + start );
 }
 
-Elem& Sequence::at( int64_t idx )
+template <typename T>
+static void append_column( Data::Column<T>& col, const Data::Column<T>& rhs, int64_t rhs_start, int64_t length )
 {
-    sys_assert( idx >= 0 && idx < size, "Sequence bounds error." );
-    return compressed ? comp : data[idx];
+    const auto rd_start = rhs.cbegin() + rhs_start;
+    col.insert( col.end(), rd_start, rd_start + length );
 }
 
-void Sequence::expand()
+void Data::append( const Data& rhs, int64_t rhs_start, int64_t length )
 {
-    data = expanded();
-    compressed = false;
+    append_column( pitch, rhs.pitch, rhs_start, length );
+    append_column( vel, rhs.vel, rhs_start, length );
+    append_column( dur, rhs.dur, rhs_start, length );
+    append_column( wait, rhs.wait, rhs_start, length );
 }
 
-std::vector<Elem> Sequence::get_data() const
+
+
+// Pieces
+// a run piece holds count elems progressing by step: elem, elem + step, elem + 2 * step ...
+// (single elem runs keep a zero step), a span piece holds count chunk elems from offset.
+// Concat and slicing share chunks between sequences instead of copying them,
+// a shared chunk is copied before it is written (see zip_pieces).
+
+using Chunk = Sequence::Chunk;
+using Piece = Sequence::Piece;
+using Pieces = Sequence::Pieces;
+
+// a single endless run, stands in for the rhs of unary edits
+static const Pieces UNBOUNDED = { { Elem(), Elem(), INT64_MAX } };
+
+// beyond this many pieces, flatten into one chunk if pieces average < 2 elems
+static constexpr int64_t PIECE_FLATTEN_MIN = 16;
+
+// spans up to this size are copied rather than shared, so that
+// concatenating short sequences grows a single chunk
+static constexpr int64_t SPAN_COPY_MAX = 64;
+
+static constexpr int64_t CHUNK_RESERVE = 16;
+
+// sequences up to this size keep single elem runs, which fit the inline pieces
+static constexpr int64_t SMALL_SIZE = (int64_t )Sequence::INLINE_PIECES;
+
+// base + step * k, wrapping like repeated adds of step would
+template <typename T>
+static T step_value( T base, T step, int64_t k )
 {
-    return compressed ? expanded() : data;
+    return (T )((uint64_t )base + (uint64_t )step * (uint64_t )k);
 }
 
-std::vector<Elem> Sequence::expanded() const
+static Elem elem_at( const Elem& base, const Elem& step, int64_t k )
 {
-    return Data( size, comp );
+    Elem e;
+    e.pitch = step_value( base.pitch, step.pitch, k );
+    e.vel = step_value( base.vel, step.vel, k );
+    e.dur = step_value( base.dur, step.dur, k );
+    e.wait = step_value( base.wait, step.wait, k );
+    return e;
 }
 
-void Sequence::resize( int64_t end )
+static Elem elem_at( const Piece& p, int64_t k )
 {
-    if ( end < size ) {
-        size = end;
+    return p.is_span() ? p.chunk->get( p.offset + k ) : elem_at( p.elem, p.step, k );
+}
 
-        if ( compressed )
-            return;
+static Chunk new_chunk()
+{
+    return std::allocate_shared<Data>( PoolAllocator<Data>() );
+}
 
-        data.resize( std::max( end, (int64_t )0 ) );
-        return;
-    }
+static bool is_constant( const Piece& p )
+{
+    return !p.is_span() && (p.count == 1 || p.step == Elem());
+}
 
-    size = end;
+// no other piece refers to the chunk of p
+static bool is_unique( const Piece& p )
+{
+    return p.is_span() && p.chunk.use_count() == 1;
+}
 
-    if ( compressed ) {
-        if ( comp == Elem() )
-            return;
+// the piece of p starting k elems in
+static Piece sub_piece( const Piece& p, int64_t k, int64_t count )
+{
+    Piece s = p;
+    s.count = count;
 
-        expand();
+    if ( p.is_span() ) {
+        s.offset += k;
+    } else {
+        s.elem = elem_at( p.elem, p.step, k );
+        s.step = (count > 1) ? p.step : Elem();
     }
 
-    data.resize( end );
+    return s;
 }
 
-void Sequence::expect( int64_t end )
+static void push_piece( Pieces& pieces, const Piece& piece )
 {
-    if ( end < size )
+    if ( piece.count <= 0 )
         return;
 
-    size = end;
+    if ( !pieces.empty() ) {
+        Piece& last = pieces.back();
+
+        if ( last.is_span() || piece.is_span() ) {
+            if ( last.chunk == piece.chunk && last.offset + last.count == piece.offset ) {
+                last.count += piece.count;
+                return;
+            }
+        } else {
+            // the step both runs would share once joined
+            Elem step = piece.elem;
+            step -= last.elem;
+            if ( last.count > 1 )
+                step = last.step;
+            else if ( piece.count > 1 )
+                step = piece.step;
+
+            if ( (piece.count == 1 || piece.step == step) && elem_at( last.elem, step, last.count ) == piece.elem ) {
+                last.step = step;
+                last.count += piece.count;
+                return;
+            }
+        }
+    }
+
+    const int64_t pos = pieces.empty() ? 0 : pieces.back().pos + pieces.back().count;
+    pieces.push_back( piece );
+    pieces.back().pos = pos;
+    if ( !piece.is_span() && piece.count == 1 )
+        pieces.back().step = Elem();
+}
+
+static void push_run( Pieces& pieces, const Elem& elem, int64_t count )
+{
+    Piece p;
+    p.elem = elem;
+    p.count = count;
+    push_piece( pieces, p );
+}
+
+// pushes the elems of a piece as single elem runs
+static void push_elems( Pieces& pieces, const Piece& piece )
+{
+    for ( int64_t i = 0; i < piece.count; i ++ )
+        push_run( pieces, elem_at( piece, i ), 1 );
+}
 
-    if ( compressed ) {
-        if ( comp == Elem() )
+// walks a piece list from a position, found by binary search on piece positions
+struct PieceCursor
+{
+    PieceCursor( const Pieces& pieces, int64_t pos )
+        : pieces { pieces }
+    {
+        const auto itr = std::upper_bound( pieces.cbegin(), pieces.cend(), pos, []( int64_t p, const Piece& piece ) {
+            return p < piece.pos;
+        } );
+
+        if ( itr == pieces.cbegin() ) {
+            idx = pieces.size();
             return;
+        }
+
+        idx = (size_t )(itr - pieces.cbegin()) - 1;
+        left = pieces[idx].pos + pieces[idx].count - pos;
+        if ( left <= 0 ) {
+            idx = pieces.size();
+            left = 0;
+        }
+    }
 
-        expand();
+    const Piece& current() const { return pieces[idx]; }
+    int64_t offset() const { return current().count - left; }
+    Elem elem() const { return elem_at( current(), offset() ); }
+    Piece piece( int64_t n ) const { return sub_piece( current(), offset(), n ); }
+
+    void advance( int64_t n )
+    {
+        left -= n;
+        if ( left == 0 && ++ idx < pieces.size() )
+            left = pieces[idx].count;
     }
 
-    data.resize( end );
+    const Pieces&   pieces;
+    size_t          idx         = 0;
+    int64_t         left        = 0;
+};
+
+// fn( piece, offset ) for each piece in [start, start + length)
+template <typename Fn>
+static void for_each_piece( const Pieces& pieces, int64_t start, int64_t length, Fn fn )
+{
+    PieceCursor pc( pieces, start );
+    int64_t offset = 0;
+
+    while ( offset < length && pc.left > 0 ) {
+        const int64_t n = std::min( pc.left, length - offset );
+        fn( pc.piece( n ), offset );
+        pc.advance( n );
+        offset += n;
+    }
 }
 
-void Sequence::crop( int64_t start, int64_t length )
+// appends the pieces covering [start, start + length), zero padded past the end of rhs
+static void append_pieces( Pieces& pieces, const Pieces& rhs, int64_t start, int64_t length )
 {
-    size = length;
+    int64_t appended = 0;
+    for_each_piece( rhs, start, length, [&]( const Piece& piece, int64_t ) {
+        push_piece( pieces, piece );
+        appended += piece.count;
+    } );
 
-    if ( compressed )
+    push_run( pieces, Elem(), length - appended );
+}
+
+static void truncate_pieces( Pieces& pieces, int64_t end )
+{
+    if ( end <= 0 ) {
+        pieces.clear();
         return;
+    }
 
-    data.resize( start + length );
-    data.erase( data.begin(), data.begin() + start );
+    PieceCursor pc( pieces, end - 1 );
+    if ( pc.left == 0 )
+        return;
+
+    Piece& p = pieces[pc.idx];
+    p.count = end - p.pos;
+    if ( !p.is_span() && p.count == 1 )
+        p.step = Elem();
+
+    pieces.resize( pc.idx + 1 );
 }
 
-void Sequence::mask( AttrType attr )
+static void merge_pieces( Pieces& pieces )
 {
-    MDDL_DISAMBIGUATE_ONE_ATTR_FN( mask_attr, attr );
+    Pieces out;
+    out.reserve( pieces.size() );
+    for ( const Piece& p : pieces )
+        push_piece( out, p );
+
+    pieces = std::move( out );
 }
 
-template <auto M>
-void Sequence::mask_attr()
+template <typename T>
+static void fill_column( Data::Column<T>& col, int64_t start, int64_t count, T base, T step )
+{
+    T* wr = col.data() + start;
+    for ( int64_t i = 0; i < count; i ++ )
+        wr[i] = step_value( base, step, i );
+}
+
+// writes the elems of a piece into data from start
+static void write_piece( Data& data, int64_t start, const Piece& p )
+{
+    if ( p.is_span() ) {
+        data.copy( start, *p.chunk, p.offset, p.count );
+        return;
+    }
+
+    if ( is_constant( p ) ) {
+        data.fill( start, p.count, p.elem );
+        return;
+    }
+
+    fill_column( data.pitch, start, p.count, p.elem.pitch, p.step.pitch );
+    fill_column( data.vel, start, p.count, p.elem.vel, p.step.vel );
+    fill_column( data.dur, start, p.count, p.elem.dur, p.step.dur );
+    fill_column( data.wait, start, p.count, p.elem.wait, p.step.wait );
+}
+
+// the chunk at the end of pieces, started anew unless it is unique and ends there
+static Data& tail_chunk( Pieces& pieces, int64_t reserve )
 {
-    for ( Elem& e : data ) {
-        Elem mask;
-        mask.*M = e.*M;
-        e = mask;
+    if ( !pieces.empty() ) {
+        const Piece& last = pieces.back();
+        if ( is_unique( last ) && last.offset + last.count == last.chunk->size() )
+            return *last.chunk;
     }
+
+    Piece p;
+    p.chunk = new_chunk();
+    p.chunk->reserve( std::max( reserve, CHUNK_RESERVE ) );
+    p.pos = pieces.empty() ? 0 : pieces.back().pos + pieces.back().count;
+    pieces.push_back( p );
+
+    return *p.chunk;
 }
 
-void Sequence::assign( int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
+// copies a span onto the end of pieces, geometric growth comes from the chunk columns
+static void append_copy( Pieces& pieces, const Piece& span )
 {
-    if ( compressed ) {
-        if ( rhs.compressed && comp == rhs.comp && size == length )
+    tail_chunk( pieces, span.count ).append( *span.chunk, span.offset, span.count );
+    pieces.back().count += span.count;
+}
+
+static void flatten_pieces( Pieces& pieces, int64_t size )
+{
+    mem_charge_expansion();
+
+    Piece p;
+    p.chunk = new_chunk();
+    p.chunk->resize( size );
+    p.count = size;
+
+    for_each_piece( pieces, 0, size, [&]( const Piece& piece, int64_t offset ) {
+        write_piece( *p.chunk, offset, piece );
+    } );
+
+    pieces.clear();
+    pieces.push_back( p );
+}
+
+// rebuilds pieces with the rhs pieces of [rhs_start, rhs_start + length) applied over [start, start + length),
+// splitting lhs pieces wherever rhs pieces change.
+// run_fn( run, rhs run ) combines two runs, returning false if the result is not a progression.
+// span_fn( chunk, offset, rhs piece ) writes rhs piece count elems of chunk from offset in place.
+// lhs pieces that can't stay runs, or whose chunk is shared, are copied into a new chunk first.
+template <typename RunFn, typename SpanFn>
+static void zip_pieces( Pieces& pieces, int64_t start, const Pieces& rhs, int64_t rhs_start, int64_t length, RunFn run_fn, SpanFn span_fn )
+{
+    PieceCursor lc( pieces, start );
+    PieceCursor rc( rhs, rhs_start );
+
+    if ( lc.left >= length ) {
+        Piece& p = pieces[lc.idx];
+
+        // within a single unique chunk, write in place
+        if ( is_unique( p ) ) {
+            const int64_t offset = p.offset + lc.offset();
+            for_each_piece( rhs, rhs_start, length, [&]( const Piece& piece, int64_t k ) {
+                span_fn( *p.chunk, offset + k, piece );
+            } );
             return;
-        expand();
+        }
+
+        // exactly one lhs run against one rhs run
+        if ( !p.is_span() && p.count == length && rc.left >= length ) {
+            Piece r = p;
+            const Piece rp = rc.piece( length );
+            if ( !rp.is_span() && run_fn( r, rp ) ) {
+                p = r;
+                merge_pieces( pieces );
+                return;
+            }
+        }
+    }
+
+    const int64_t total = pieces.back().pos + pieces.back().count;
+
+    // lhs chunks only held by one piece, before the copies below add references
+    SmallVector<bool, Sequence::INLINE_PIECES> owned;
+    for ( size_t i = lc.idx; i < pieces.size() && pieces[i].pos < start + length; i ++ )
+        owned.push_back( is_unique( pieces[i] ) );
+
+    const size_t first = lc.idx;
+
+    Pieces out;
+    out.reserve( pieces.size() + 4 );
+
+    for_each_piece( pieces, 0, start, [&]( const Piece& piece, int64_t ) {
+        push_piece( out, piece );
+    } );
+
+    Chunk fresh;
+    for ( int64_t left = length; left > 0; ) {
+        const int64_t n = std::min( { lc.left, rc.left, left } );
+        const Piece rp = rc.piece( n );
+
+        Piece lp = lc.piece( n );
+        if ( !lp.is_span() && !rp.is_span() && run_fn( lp, rp ) ) {
+            push_piece( out, lp );
+        } else if ( owned[lc.idx - first] ) {
+            lp = lc.piece( n );
+            span_fn( *lp.chunk, lp.offset, rp );
+            push_piece( out, lp );
+        } else if ( total <= SMALL_SIZE ) {
+            // single elem runs always combine
+            for ( int64_t i = 0; i < n; i ++ ) {
+                Piece r;
+                r.elem = elem_at( lc.current(), lc.offset() + i );
+                r.count = 1;
+
+                Piece r_rhs;
+                r_rhs.elem = elem_at( rp, i );
+                r_rhs.count = 1;
+
+                run_fn( r, r_rhs );
+                push_piece( out, r );
+            }
+        } else {
+            if ( !fresh ) {
+                mem_charge_expansion();
+                fresh = new_chunk();
+                fresh->reserve( left );
+            }
+
+            Piece s;
+            s.chunk = fresh;
+            s.offset = fresh->size();
+            s.count = n;
+
+            fresh->resize( s.offset + n );
+            write_piece( *fresh, s.offset, lc.piece( n ) );
+            span_fn( *fresh, s.offset, rp );
+            push_piece( out, s );
+        }
+
+        lc.advance( n );
+        rc.advance( n );
+        left -= n;
+    }
+
+    for_each_piece( pieces, start + length, INT64_MAX, [&]( const Piece& piece, int64_t ) {
+        push_piece( out, piece );
+    } );
+
+    pieces = std::move( out );
+}
+
+
+
+// Ops
+// lhs member M1 is combined with rhs member M2, casting to the lhs member type first.
+// Run pairs are combined run by run while the result stays a progression,
+// everything else is written through the column kernels (see kernels.hpp).
+
+template <typename T>
+static void apply_op( KernelOp op, T& a, T b )
+{
+    switch ( op ) {
+        case KernelOp::ASSIGN: a = b; break;
+        case KernelOp::ADD: a += b; break;
+        case KernelOp::SUBTRACT: a -= b; break;
+        case KernelOp::MULTIPLY: a *= b; break;
+        case KernelOp::DIVIDE: a /= b; break;
+    }
+}
+
+// (a + sa * i) op (b + sb * i) as a new progression over n elems
+template <typename T>
+static bool apply_step( KernelOp op, T& a, T& sa, T b, T sb, int64_t n )
+{
+    if ( n == 1 || (sa == 0 && sb == 0) ) {
+        apply_op( op, a, b );
+        sa = 0;
+        return true;
     }
 
-    const auto wr_start = data.begin() + start;
-    const auto wr_end = wr_start + length;
+    switch ( op ) {
+        case KernelOp::ASSIGN: a = b; sa = sb; return true;
+        case KernelOp::ADD: a += b; sa += sb; return true;
+        case KernelOp::SUBTRACT: a -= b; sa -= sb; return true;
+        case KernelOp::MULTIPLY:
+            if ( sb == 0 ) {
+                sa *= b;
+            } else if ( sa == 0 ) {
+                sa = (T )(a * sb);
+            } else {
+                return false;
+            }
+
+            a *= b;
+            return true;
+        default:
+            return false;
+    }
+}
 
-    if ( rhs.compressed ) {
-        std::fill( wr_start, wr_end, rhs.comp );
+// casts an M2 progression to M1, widening only if it doesn't wrap within n elems
+template <typename To, typename From>
+static bool cast_step( From base, From step, int64_t n, To& to_base, To& to_step )
+{
+    if constexpr ( sizeof( To ) <= sizeof( From ) ) {
+        to_base = (To )base;
+        to_step = (To )step;
     } else {
-        const auto rd_start = rhs.data.cbegin() + rhs_start;
-        const auto rd_end = rd_start + length;
+        const int64_t s = (int64_t )(std::make_signed_t<From> )step;
+        const int64_t last = (int64_t )base + s * (n - 1);
+        if ( last < std::numeric_limits<From>::min() || last > std::numeric_limits<From>::max() )
+            return false;
 
-        std::copy( rd_start, rd_end, wr_start );
+        to_base = (To )base;
+        to_step = (To )s;
     }
+
+    return true;
 }
 
-void Sequence::assign( AttrType attr, AttrType rhs_attr, int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
+template <typename T>
+static bool is_identity( KernelOp op, T b )
 {
-    MDDL_DISAMBIGUATE_TWO_ATTR_FN( assign_attr, attr, rhs_attr, start, rhs, rhs_start, length );
+    switch ( op ) {
+        case KernelOp::ADD:
+        case KernelOp::SUBTRACT: return b == 0;
+        case KernelOp::MULTIPLY:
+        case KernelOp::DIVIDE: return b == 1;
+        default: return false;
+    }
 }
-    
+
+// clamps a range pair to the extent of both sequences
+static int64_t clamp_length( const Sequence& lhs, int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
+{
+    length = std::min( { length, lhs.size - start, rhs.size - rhs_start } );
+    return std::max( length, (int64_t )0 );
+}
+
 template <auto M1, auto M2>
-void Sequence::assign_attr( int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
+static bool apply_run_attr( KernelOp op, Piece& r, const Piece& rhs )
 {
     typedef member_t<decltype(M1)> M1_t;
 
-    if ( compressed ) {
-        if ( rhs.compressed && comp.*M1 == (M1_t )(rhs.comp.*M2) && size == length )
-            return;
-        expand();
-    }
+    M1_t b, sb;
+    if ( !cast_step( rhs.elem.*M2, rhs.step.*M2, rhs.count, b, sb ) )
+        return false;
 
-    const auto wr_start = data.begin() + start;
-    const auto wr_end = wr_start + length;
+    return apply_step( op, r.elem.*M1, r.step.*M1, b, sb, r.count );
+}
 
-    if ( rhs.compressed ) {
-        auto m2 = (M1_t )(rhs.comp.*M2);
-        for ( auto wr = wr_start; wr < wr_end; wr ++ )
-            (*wr).*M1 = m2;
-    } else {
-        const auto rd_start = rhs.data.cbegin() + rhs_start;
+template <auto M1, auto M2>
+static void apply_span_attr( KernelOp op, Data& chunk, int64_t offset, const Piece& rhs )
+{
+    typedef member_t<decltype(M1)> M1_t;
+    typedef member_t<decltype(M2)> M2_t;
+
+    M1_t* wr = chunk.column<M1>().data() + offset;
+
+    if ( rhs.is_span() ) {
+        kernel_column( op, wr, rhs.chunk->column<M2>().data() + rhs.offset, rhs.count );
+        return;
+    }
+
+    const M2_t b = rhs.elem.*M2;
+    const M2_t sb = rhs.step.*M2;
 
-        auto wr = wr_start;
-        auto rd = rd_start;
-        for ( ; wr < wr_end; wr ++, rd ++ )
-            (*wr).*M1 = (M1_t )((*rd).*M2);
+    if ( sb == 0 ) {
+        if ( !is_identity( op, (M1_t )b ) )
+            kernel_value( op, wr, (M1_t )b, rhs.count );
+        return;
     }
+
+    for ( int64_t i = 0; i < rhs.count; i ++ )
+        apply_op( op, wr[i], (M1_t )step_value( b, sb, i ) );
 }
 
-void Sequence::assign_value( AttrType attr, int64_t start, int64_t length, int64_t value )
+// Transform
+// value ops over a whole sequence are deferred as elem * mul + add per attribute,
+// which is exact under the wrapping arithmetic of the eager ops. DIVIDE is never deferred.
+
+using Transform = Sequence::Transform;
+
+template <typename T>
+static T affine( T x, T mul, T add )
 {
-    MDDL_DISAMBIGUATE_ONE_ATTR_FN( assign_value_attr, attr, start, length, value );
+    return (T )((uint64_t )x * (uint64_t )mul + (uint64_t )add);
 }
 
 template <auto M>
-void Sequence::assign_value_attr( int64_t start, int64_t length, int64_t value )
+static bool is_identity( const Transform& t )
+{
+    return t.mul.*M == 1 && t.add.*M == 0;
+}
+
+template <auto M>
+static void transform_run_attr( Piece& r, const Transform& t )
 {
     typedef member_t<decltype(M)> M_t;
 
-    M_t m_value = (M_t )value;
+    r.elem.*M = affine( r.elem.*M, t.mul.*M, t.add.*M );
+    r.step.*M = affine( r.step.*M, t.mul.*M, (M_t )0 );
+}
 
-    if ( compressed ) {
-        if ( comp.*M == m_value )
-            return;
+template <auto M>
+static void transform_span_attr( Data& chunk, int64_t offset, int64_t count, const Transform& t )
+{
+    if ( !is_identity<M>( t ) )
+        kernel_affine( chunk.column<M>().data() + offset, t.mul.*M, t.add.*M, count );
+}
 
-        if ( size == length ) {
-            comp.*M = m_value;
-            return;
-        }
+static Elem transform_elem( const Transform& t, Elem e )
+{
+    if ( !t.active )
+        return e;
+
+    e.pitch = affine( e.pitch, t.mul.pitch, t.add.pitch );
+    e.vel = affine( e.vel, t.mul.vel, t.add.vel );
+    e.dur = affine( e.dur, t.mul.dur, t.add.dur );
+    e.wait = affine( e.wait, t.mul.wait, t.add.wait );
+    return e;
+}
 
-        expand();
-    }
+// composes op value after the pending transform of M
+template <auto M>
+static bool defer_value( Sequence& lhs, KernelOp op, member_t<decltype(M)> value )
+{
+    typedef member_t<decltype(M)> M_t;
 
-    const auto wr_start = data.begin() + start;
-    const auto wr_end = wr_start + length;
+    M_t& mul = lhs.pending.mul.*M;
+    M_t& add = lhs.pending.add.*M;
+
+    switch ( op ) {
+        case KernelOp::ASSIGN: mul = 0; add = value; break;
+        case KernelOp::ADD: add = affine( add, (M_t )1, value ); break;
+        case KernelOp::SUBTRACT: add = affine( value, (M_t )-1, add ); break;
+        case KernelOp::MULTIPLY:
+            mul = affine( mul, value, (M_t )0 );
+            add = affine( add, value, (M_t )0 );
+            break;
+        default: return false;
+    }
 
-    for ( auto wr = wr_start; wr < wr_end; wr ++ )
-        (*wr).*M = m_value;
+    lhs.pending.active = true;
+    return true;
 }
 
-int64_t Sequence::value()
+template <auto M1, auto M2>
+static void apply_attr( Sequence& lhs, KernelOp op, int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
 {
-    return (int64_t )(compressed ? comp.pitch : data[0].pitch);
+    length = clamp_length( lhs, start, rhs, rhs_start, length );
+    if ( length == 0 )
+        return;
+
+    lhs.flush();
+    rhs.flush();
+
+    zip_pieces( lhs.pieces, start, rhs.pieces, rhs_start, length, [op]( Piece& r, const Piece& piece ) {
+        return apply_run_attr<M1, M2>( op, r, piece );
+    }, [op]( Data& chunk, int64_t offset, const Piece& piece ) {
+        apply_span_attr<M1, M2>( op, chunk, offset, piece );
+    } );
+
+    lhs.settle();
 }
 
-int64_t Sequence::value( AttrType attr )
+static void apply_all( Sequence& lhs, KernelOp op, int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
 {
-    MDDL_DISAMBIGUATE_ONE_ATTR_FN( return value_attr, attr );
-    return 0;
+    length = clamp_length( lhs, start, rhs, rhs_start, length );
+    if ( length == 0 )
+        return;
+
+    lhs.flush();
+    rhs.flush();
+
+    if ( op == KernelOp::ASSIGN && length > SPAN_COPY_MAX ) {
+        // splice the rhs pieces in, sharing their chunks
+        Pieces out;
+        append_pieces( out, lhs.pieces, 0, start );
+        append_pieces( out, rhs.pieces, rhs_start, length );
+        append_pieces( out, lhs.pieces, start + length, lhs.size - start - length );
+        lhs.pieces = std::move( out );
+        lhs.settle();
+        return;
+    }
+
+    zip_pieces( lhs.pieces, start, rhs.pieces, rhs_start, length, [op]( Piece& r, const Piece& piece ) {
+        return apply_run_attr<&Elem::pitch, &Elem::pitch>( op, r, piece )
+            && apply_run_attr<&Elem::vel, &Elem::vel>( op, r, piece )
+            && apply_run_attr<&Elem::dur, &Elem::dur>( op, r, piece )
+            && apply_run_attr<&Elem::wait, &Elem::wait>( op, r, piece );
+    }, [op]( Data& chunk, int64_t offset, const Piece& piece ) {
+        apply_span_attr<&Elem::pitch, &Elem::pitch>( op, chunk, offset, piece );
+        apply_span_attr<&Elem::vel, &Elem::vel>( op, chunk, offset, piece );
+        apply_span_attr<&Elem::dur, &Elem::dur>( op, chunk, offset, piece );
+        apply_span_attr<&Elem::wait, &Elem::wait>( op, chunk, offset, piece );
+    } );
+
+    lhs.settle();
 }
 
 template <auto M>
-int64_t Sequence::value_attr()
+static void apply_value( Sequence& lhs, KernelOp op, int64_t start, int64_t length, member_t<decltype(M)> value )
 {
-    rt_assert( compressed || data.size() > 0, "Cannot get value from empty sequence." );
+    typedef member_t<decltype(M)> M_t;
+
+    length = std::min( length, lhs.size - start );
+    if ( length <= 0 )
+        return;
+
+    if ( start == 0 && length == lhs.size && defer_value<M>( lhs, op, value ) )
+        return;
+
+    lhs.flush();
 
-    return (int64_t )(compressed ? comp.*M : data[0].*M);
+    zip_pieces( lhs.pieces, start, UNBOUNDED, 0, length, [=]( Piece& r, const Piece& ) {
+        return apply_step( op, r.elem.*M, r.step.*M, value, (M_t )0, r.count );
+    }, [=]( Data& chunk, int64_t offset, const Piece& piece ) {
+        kernel_value( op, chunk.column<M>().data() + offset, value, piece.count );
+    } );
+
+    lhs.settle();
 }
 
-void Sequence::concat( const Sequence& rhs, int64_t rhs_start, int64_t rhs_length )
+
+
+Sequence::Cursor::Cursor( const Sequence& seq, int64_t pos, int64_t length )
+    : seq   { seq }
 {
-    if ( compressed ) {
-        if ( rhs.compressed && comp == rhs.comp ) {
-            size += rhs_length;
-            return;
-        }
+    const PieceCursor pc( seq.pieces, pos );
+    if ( pc.left == 0 )
+        return;
 
-        expand();
+    idx = pc.idx;
+    offset = pc.offset();
+    left = std::min( length, seq.size - pos );
+}
+
+Elem Sequence::Cursor::get() const
+{
+    return transform_elem( seq.pending, elem_at( seq.pieces[idx], offset ) );
+}
+
+void Sequence::Cursor::next()
+{
+    left --;
+    if ( ++ offset == seq.pieces[idx].count ) {
+        idx ++;
+        offset = 0;
     }
+}
 
-    size += rhs_length;
-    data.reserve( size );
 
-    if ( rhs.compressed ) {
-        for ( int i = 0; i < (int )rhs_length; i ++ )
-            data.push_back( rhs.comp );
-    } else {
-        const auto rd_start = rhs.data.cbegin() + rhs_start;
-        const auto rd_end = rd_start + rhs_length;
-        data.insert( data.end(), rd_start, rd_end );
+
+void* Sequence::operator new( size_t size )
+{
+    Arena* arena = Arena::local;
+    if ( arena != nullptr && arena->enabled ) {
+        void* p = arena->alloc( size );
+        if ( p != nullptr )
+            return p;
     }
+
+    return pool_alloc( size );
 }
 
-void Sequence::concat( AttrType attr, AttrType rhs_attr, const Sequence& rhs, int64_t rhs_start, int64_t rhs_length )
+void Sequence::operator delete( void* p, size_t size )
 {
-    MDDL_DISAMBIGUATE_TWO_ATTR_FN( concat_attr, attr, rhs_attr, rhs, rhs_start, rhs_length );
+    // by address, the block may be dropped on any thread
+    Arena* arena = Arena::owner( p );
+    if ( arena != nullptr ) {
+        arena->free( p );
+        return;
+    }
+
+    pool_free( p, size );
 }
 
-template <auto M1, auto M2>
-void Sequence::concat_attr( const Sequence& rhs, int64_t rhs_start, int64_t rhs_length )
+Sequence::Sequence()
+    : Sequence( 0 )
+{};
+
+Sequence::Sequence( int64_t value )
+    : Sequence( Elem(), value )
+{}
+
+Sequence::Sequence( const Elem& elem, int64_t size )
+    : size          { size }
 {
-    typedef member_t<decltype(M1)> M1_t;
+    mem_charge_seq();
+    push_run( pieces, elem, size );
+}
 
-    if ( compressed ) {
-        if ( rhs.compressed && comp.*M1 == (M1_t )(rhs.comp.*M2) ) {
-            size += rhs_length;
-            return;
-        }
+Sequence::Sequence( const Sequence& rhs, int64_t rhs_start, int64_t rhs_length )
+    : size          { rhs_length }
+{
+    mem_charge_seq();
+
+    if ( rhs_length <= 0 )
+        return;
 
-        expand();
+    // zero padding must not pick up the transform
+    if ( rhs_start + rhs_length > rhs.size ) {
+        rhs.flush();
+    } else {
+        pending = rhs.pending;
     }
 
-    size += rhs_length;
-    data.reserve( size );
+    append_pieces( pieces, rhs.pieces, rhs_start, rhs_length );
+}
 
-    if ( rhs.compressed ) {
-        Elem m_comp = {};
-        m_comp.*M1 = (M1_t )(rhs.comp.*M2);
+Sequence::~Sequence()
+{
+    mem_release_seq();
+    delete rec;
+}
 
-        for ( int i = 0; i < (int )rhs_length; i ++ )
-            data.push_back( m_comp );
+void Sequence::push_back( const Elem& e )
+{
+    flush();
+    if ( size < SMALL_SIZE && (pieces.empty() || !pieces.back().is_span()) ) {
+        push_run( pieces, e, 1 );
     } else {
-        const auto rd_start = rhs.data.cbegin() + rhs_start;
-        const auto rd_end = rd_start + rhs_length;
+        tail_chunk( pieces, 0 ).push_back( e );
+        pieces.back().count ++;
+    }
 
-        for ( auto rd = rd_start; rd < rd_end; rd ++ ) {
-            Elem m_rd = {};
-            m_rd.*M1 = (M1_t )((*rd).*M2);
-            data.push_back( m_rd );
-        }
+    size ++;
+}
+
+// the recording must be closed first, rec is dropped by the next sync
+void Sequence::mark_complete()
+{
+    complete.store( true, std::memory_order_release );
+    complete.notify_all();
+}
+
+void Sequence::wait_complete() const
+{
+    complete.wait( false, std::memory_order_acquire );
+}
+
+// exec thread, returns early if the recording completes with fewer notes
+void Sequence::wait_recorded( int64_t n ) const
+{
+    if ( rec != nullptr )
+        rec->wait( n );
+}
+
+// appends the notes committed since the last sync, the recording
+// is dropped and the literal interned once complete
+void Sequence::sync_recording()
+{
+    const bool done = !recording();
+    const int64_t end = rec->committed();
+
+    rec->read( rec->synced, end, [this]( const Elem& e ) {
+        push_back( e );
+    } );
+    rec->synced = end;
+
+    if ( done ) {
+        delete rec;
+        rec = nullptr;
+        intern( *this );
     }
 }
 
-void Sequence::extend( int64_t length )
+// FNV-1a over the elems
+uint64_t Sequence::hash() const
 {
-    resize( size + length );
+    if ( hash_cache != 0 )
+        return hash_cache;
+
+    uint64_t h = 0xcbf29ce484222325;
+    const auto mix = [&h]( uint64_t v ) {
+        h ^= v;
+        h *= 0x100000001b3;
+    };
+
+    mix( (uint64_t )size );
+    for ( Cursor c( *this, 0, size ); !c.done(); c.next() ) {
+        const Elem e = c.get();
+        mix( ((uint64_t )e.pitch << 8) | e.vel );
+        mix( (uint32_t )e.dur );
+        mix( (uint32_t )e.wait );
+    }
+
+    return h;
 }
 
+bool Sequence::same_elems( const Sequence& rhs ) const
+{
+    if ( size != rhs.size )
+        return false;
 
+    Cursor c( *this, 0, size );
+    for ( Cursor r( rhs, 0, size ); !c.done(); c.next(), r.next() )
+        if ( !(c.get() == r.get()) )
+            return false;
 
-void Sequence::add( int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
+    return true;
+}
+
+Elem Sequence::at( int64_t idx ) const
 {
-    if ( rhs.compressed && rhs.comp == Elem() )
-        return;
-    
-    if ( compressed ) {
-        if ( rhs.compressed && size == length ) {
-            comp += rhs.comp;
-            return;
+    sys_assert( idx >= 0 && idx < size, "Sequence bounds error." );
+    return transform_elem( pending, PieceCursor( pieces, idx ).elem() );
+}
+
+bool Sequence::silent() const
+{
+    flush();
+    return std::all_of( pieces.cbegin(), pieces.cend(), []( const Piece& p ) {
+        return !p.is_span() && p.elem.vel == 0 && p.step.vel == 0;
+    } );
+}
+
+std::vector<Elem> Sequence::get_data() const
+{
+    flush();
+
+    std::vector<Elem> v;
+    v.reserve( std::max( size, (int64_t )0 ) );
+
+    for ( const Piece& p : pieces ) {
+        if ( is_constant( p ) ) {
+            v.insert( v.end(), p.count, p.elem );
+            continue;
         }
-        
-        expand();
+
+        for ( int64_t i = 0; i < p.count; i ++ )
+            v.push_back( elem_at( p, i ) );
     }
 
+    return v;
+}
+
+void Sequence::flush() const
+{
+    if ( !pending.active )
+        return;
 
-    const auto wr_start = data.begin() + start;
-    const auto wr_end = wr_start + length;
+    const Transform t = pending;
+    pending = Transform();
 
-    if ( rhs.compressed ) {
-        for ( auto wr = wr_start; wr < wr_end; wr ++ )
-            *wr += rhs.comp;
-    } else {
-        const auto rd_start = rhs.data.cbegin() + rhs_start;
+    if ( size <= 0 )
+        return;
+
+    zip_pieces( pieces, 0, UNBOUNDED, 0, size, [&]( Piece& r, const Piece& ) {
+        transform_run_attr<&Elem::pitch>( r, t );
+        transform_run_attr<&Elem::vel>( r, t );
+        transform_run_attr<&Elem::dur>( r, t );
+        transform_run_attr<&Elem::wait>( r, t );
+        return true;
+    }, [&]( Data& chunk, int64_t offset, const Piece& piece ) {
+        transform_span_attr<&Elem::pitch>( chunk, offset, piece.count, t );
+        transform_span_attr<&Elem::vel>( chunk, offset, piece.count, t );
+        transform_span_attr<&Elem::dur>( chunk, offset, piece.count, t );
+        transform_span_attr<&Elem::wait>( chunk, offset, piece.count, t );
+    } );
+}
 
-        auto wr = wr_start;
-        auto rd = rd_start;
-        for ( ; wr < wr_end; wr ++, rd ++ )
-            *wr += *rd;
+// flattens into a single chunk once pieces stop paying for themselves
+void Sequence::settle()
+{
+    const int64_t n_pieces = (int64_t )pieces.size();
+    if ( n_pieces > PIECE_FLATTEN_MIN && n_pieces * 2 > size )
+        flatten_pieces( pieces, size );
+}
+
+void Sequence::resize( int64_t end )
+{
+    if ( end < size ) {
+        size = end;
+        truncate_pieces( pieces, end );
+        return;
     }
+
+    // grows with zeros
+    flush();
+    const int64_t grow = end - std::max( size, (int64_t )0 );
+    size = end;
+    push_run( pieces, Elem(), grow );
 }
 
-void Sequence::add( AttrType attr, AttrType rhs_attr, int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
+void Sequence::expect( int64_t end )
 {
-    MDDL_DISAMBIGUATE_TWO_ATTR_FN( add_attr, attr, rhs_attr, start, rhs, rhs_start, length );
+    if ( end < size )
+        return;
+
+    resize( end );
 }
-    
+
+void Sequence::crop( int64_t start, int64_t length )
+{
+    if ( start + length > size )
+        flush();
+
+    Pieces cropped;
+    append_pieces( cropped, pieces, start, length );
+    pieces = std::move( cropped );
+    size = length;
+}
+
+void Sequence::mask( AttrType attr )
+{
+    MDDL_DISAMBIGUATE_ONE_ATTR_FN( mask_attr, attr );
+}
+
+template <auto M>
+void Sequence::mask_attr()
+{
+    // clear every attribute but M
+    if constexpr ( !same_member<M, &Elem::pitch>() )
+        apply_value<&Elem::pitch>( *this, KernelOp::ASSIGN, 0, size, 0 );
+    if constexpr ( !same_member<M, &Elem::vel>() )
+        apply_value<&Elem::vel>( *this, KernelOp::ASSIGN, 0, size, 0 );
+    if constexpr ( !same_member<M, &Elem::dur>() )
+        apply_value<&Elem::dur>( *this, KernelOp::ASSIGN, 0, size, 0 );
+    if constexpr ( !same_member<M, &Elem::wait>() )
+        apply_value<&Elem::wait>( *this, KernelOp::ASSIGN, 0, size, 0 );
+}
+
+void Sequence::assign( int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
+{
+    apply_all( *this, KernelOp::ASSIGN, start, rhs, rhs_start, length );
+}
+
+void Sequence::assign( AttrType attr, AttrType rhs_attr, int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
+{
+    MDDL_DISAMBIGUATE_TWO_ATTR_FN( assign_attr, attr, rhs_attr, start, rhs, rhs_start, length );
+}
+
 template <auto M1, auto M2>
-void Sequence::add_attr( int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
+void Sequence::assign_attr( int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
 {
-    typedef member_t<decltype(M1)> M1_t;
+    apply_attr<M1, M2>( *this, KernelOp::ASSIGN, start, rhs, rhs_start, length );
+}
 
-    M1_t m_comp = (M1_t )(rhs.comp.*M2);
-    if ( rhs.compressed && m_comp == 0 )
-        return;
+void Sequence::assign_value( AttrType attr, int64_t start, int64_t length, int64_t value )
+{
+    MDDL_DISAMBIGUATE_ONE_ATTR_FN( assign_value_attr, attr, start, length, value );
+}
 
-    if ( compressed ) {
-        if ( rhs.compressed && size == length ) {
-            comp.*M1 += m_comp;
-            return;
+template <auto M>
+void Sequence::assign_value_attr( int64_t start, int64_t length, int64_t value )
+{
+    typedef member_t<decltype(M)> M_t;
+    apply_value<M>( *this, KernelOp::ASSIGN, start, length, (M_t )value );
+}
+
+int64_t Sequence::value()
+{
+    return value_attr<&Elem::pitch>();
+}
+
+int64_t Sequence::value( AttrType attr )
+{
+    MDDL_DISAMBIGUATE_ONE_ATTR_FN( return value_attr, attr );
+    return 0;
+}
+
+template <auto M>
+int64_t Sequence::value_attr()
+{
+    return pieces.empty() ? 0 : (int64_t )(transform_elem( pending, elem_at( pieces.front(), 0 ) ).*M);
+}
+
+void Sequence::concat( const Sequence& rhs, int64_t rhs_start, int64_t rhs_length )
+{
+    rhs_length = std::max( std::min( rhs_length, rhs.size - rhs_start ), (int64_t )0 );
+    const int64_t end = std::max( size, (int64_t )0 );
+
+    flush();
+    rhs.flush();
+
+    // taken first, rhs may be this sequence
+    Pieces appended;
+    append_pieces( appended, rhs.pieces, rhs_start, rhs_length );
+
+    int64_t pos = end;
+    for ( const Piece& p : appended ) {
+        if ( p.is_span() && pos + p.count <= SMALL_SIZE ) {
+            push_elems( pieces, p );
+        } else if ( p.is_span() && p.count <= SPAN_COPY_MAX ) {
+            append_copy( pieces, p );
+        } else {
+            push_piece( pieces, p );
         }
-        
-        expand();
+
+        pos += p.count;
     }
 
-    const auto wr_start = data.begin() + start;
-    const auto wr_end = wr_start + length;
+    size = end + rhs_length;
+    settle();
+}
 
-    if ( rhs.compressed ) {
-        for ( auto wr = wr_start; wr < wr_end; wr ++ )
-            (*wr).*M1 += m_comp;
-    } else {
-        const auto rd_start = rhs.data.cbegin() + rhs_start;
+void Sequence::concat( AttrType attr, AttrType rhs_attr, const Sequence& rhs, int64_t rhs_start, int64_t rhs_length )
+{
+    MDDL_DISAMBIGUATE_TWO_ATTR_FN( concat_attr, attr, rhs_attr, rhs, rhs_start, rhs_length );
+}
 
-        auto wr = wr_start;
-        auto rd = rd_start;
-        for ( ; wr < wr_end; wr ++, rd ++ )
-            (*wr).*M1 += (M1_t )((*rd).*M2);
-    }
+template <auto M1, auto M2>
+void Sequence::concat_attr( const Sequence& rhs, int64_t rhs_start, int64_t rhs_length )
+{
+    rhs_length = std::max( std::min( rhs_length, rhs.size - rhs_start ), (int64_t )0 );
+    const int64_t end = std::max( size, (int64_t )0 );
+
+    // new elems are zero in all but M1
+    resize( end + rhs_length );
+    apply_attr<M1, M2>( *this, KernelOp::ASSIGN, end, rhs, rhs_start, rhs_length );
+}
+
+void Sequence::extend( int64_t length )
+{
+    resize( size + length );
+}
+
+
+
+void Sequence::add( int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
+{
+    apply_all( *this, KernelOp::ADD, start, rhs, rhs_start, length );
+}
+
+void Sequence::add( AttrType attr, AttrType rhs_attr, int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
+{
+    MDDL_DISAMBIGUATE_TWO_ATTR_FN( add_attr, attr, rhs_attr, start, rhs, rhs_start, length );
+}
+    
+template <auto M1, auto M2>
+void Sequence::add_attr( int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
+{
+    apply_attr<M1, M2>( *this, KernelOp::ADD, start, rhs, rhs_start, length );
 }
 
 void Sequence::add_value( AttrType attr, int64_t start, int64_t length, int64_t value )
@@ -514,52 +1303,14 @@ void Sequence::add_value_attr( int64_t start, int64_t length, int64_t value )
     if ( m_value == 0 )
         return;
 
-    if ( compressed ) {
-        if ( size == length ) {
-            comp.*M += m_value;
-            return;
-        }
-        
-        expand();
-    }
-
-    const auto wr_start = data.begin() + start;
-    const auto wr_end = wr_start + length;
-
-    for ( auto wr = wr_start; wr < wr_end; wr ++ )
-        (*wr).*M += m_value;
+    apply_value<M>( *this, KernelOp::ADD, start, length, m_value );
 }
 
 
 
 void Sequence::subtract( int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
 {
-    if ( rhs.compressed && rhs.comp == Elem() )
-        return;
-    
-    if ( compressed ) {
-        if ( rhs.compressed && size == length ) {
-            comp -= rhs.comp;
-            return;
-        }
-        
-        expand();
-    }
-
-    const auto wr_start = data.begin() + start;
-    const auto wr_end = wr_start + length;
-
-    if ( rhs.compressed ) {
-        for ( auto wr = wr_start; wr < wr_end; wr ++ )
-            *wr -= rhs.comp;
-    } else {
-        const auto rd_start = rhs.data.cbegin() + rhs_start;
-
-        auto wr = wr_start;
-        auto rd = rd_start;
-        for ( ; wr < wr_end; wr ++, rd ++ )
-            *wr -= *rd;
-    }
+    apply_all( *this, KernelOp::SUBTRACT, start, rhs, rhs_start, length );
 }
 
 void Sequence::subtract( AttrType attr, AttrType rhs_attr, int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
@@ -570,35 +1321,7 @@ void Sequence::subtract( AttrType attr, AttrType rhs_attr, int64_t start, const
 template <auto M1, auto M2>
 void Sequence::subtract_attr( int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
 {
-    typedef member_t<decltype(M1)> M1_t;
-
-    M1_t m_comp = (M1_t )(rhs.comp.*M2);
-    if ( rhs.compressed && m_comp == 0 )
-        return;
-    
-    if ( compressed ) {
-        if ( rhs.compressed && size == length ) {
-            comp.*M1 -= m_comp;
-            return;
-        }
-        
-        expand();
-    }
-
-    const auto wr_start = data.begin() + start;
-    const auto wr_end = wr_start + length;
-
-    if ( rhs.compressed ) {
-        for ( auto wr = wr_start; wr < wr_end; wr ++ )
-            (*wr).*M1 -= m_comp;
-    } else {
-        const auto rd_start = rhs.data.cbegin() + rhs_start;
-
-        auto wr = wr_start;
-        auto rd = rd_start;
-        for ( ; wr < wr_end; wr ++, rd ++ )
-            (*wr).*M1 -= (M1_t )((*rd).*M2);
-    }
+    apply_attr<M1, M2>( *this, KernelOp::SUBTRACT, start, rhs, rhs_start, length );
 }
 
 void Sequence::subtract_value( AttrType attr, int64_t start, int64_t length, int64_t value )
@@ -615,49 +1338,14 @@ void Sequence::subtract_value_attr( int64_t start, int64_t length, int64_t value
     if ( m_value == 0 )
         return;
 
-    if ( compressed ) {
-        if ( size == length ) {
-            comp.*M -= m_value;
-            return;
-        }
-        
-        expand();
-    }
-
-    const auto wr_start = data.begin() + start;
-    const auto wr_end = wr_start + length;
-
-    for ( auto wr = wr_start; wr < wr_end; wr ++ )
-        (*wr).*M -= m_value;
+    apply_value<M>( *this, KernelOp::SUBTRACT, start, length, m_value );
 }
 
 
 
 void Sequence::multiply( int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
 {
-    if ( compressed ) {
-        if ( rhs.compressed && size == length ) {
-            comp *= rhs.comp;
-            return;
-        }
-        
-        expand();
-    }
-
-    const auto wr_start = data.begin() + start;
-    const auto wr_end = wr_start + length;
-
-    if ( rhs.compressed ) {
-        for ( auto wr = wr_start; wr < wr_end; wr ++ )
-            *wr *= rhs.comp;
-    } else {
-        const auto rd_start = rhs.data.cbegin() + rhs_start;
-
-        auto wr = wr_start;
-        auto rd = rd_start;
-        for ( ; wr < wr_end; wr ++, rd ++ )
-            *wr *= *rd;
-    }
+    apply_all( *this, KernelOp::MULTIPLY, start, rhs, rhs_start, length );
 }
 
 void Sequence::multiply( AttrType attr, AttrType rhs_attr, int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
@@ -668,35 +1356,7 @@ void Sequence::multiply( AttrType attr, AttrType rhs_attr, int64_t start, const
 template <auto M1, auto M2>
 void Sequence::multiply_attr( int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
 {
-    typedef member_t<decltype(M1)> M1_t;
-
-    M1_t m_comp = (M1_t )(rhs.comp.*M2);
-    if ( rhs.compressed && m_comp == 1 )
-        return;
-    
-    if ( compressed ) {
-        if ( rhs.compressed && size == length ) {
-            comp.*M1 *= m_comp;
-            return;
-        }
-        
-        expand();
-    }
-
-    const auto wr_start = data.begin() + start;
-    const auto wr_end = wr_start + length;
-
-    if ( rhs.compressed ) {
-        for ( auto wr = wr_start; wr < wr_end; wr ++ )
-            (*wr).*M1 *= m_comp;
-    } else {
-        const auto rd_start = rhs.data.cbegin() + rhs_start;
-
-        auto wr = wr_start;
-        auto rd = rd_start;
-        for ( ; wr < wr_end; wr ++, rd ++ )
-            (*wr).*M1 *= (M1_t )((*rd).*M2);
-    }
+    apply_attr<M1, M2>( *this, KernelOp::MULTIPLY, start, rhs, rhs_start, length );
 }
 
 void Sequence::multiply_value( AttrType attr, int64_t start, int64_t length, int64_t value )
@@ -713,49 +1373,14 @@ void Sequence::multiply_value_attr( int64_t start, int64_t length, int64_t value
     if ( m_value == 1 )
         return;
 
-    if ( compressed ) {
-        if ( size == length ) {
-            comp.*M *= m_value;
-            return;
-        }
-        
-        expand();
-    }
-
-    const auto wr_start = data.begin() + start;
-    const auto wr_end = wr_start + length;
-
-    for ( auto wr = wr_start; wr < wr_end; wr ++ )
-        (*wr).*M *= m_value;
+    apply_value<M>( *this, KernelOp::MULTIPLY, start, length, m_value );
 }
 
 
 
 void Sequence::divide( int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
 {
-    if ( compressed ) {
-        if ( rhs.compressed && size == length ) {
-            comp /= rhs.comp;
-            return;
-        }
-        
-        expand();
-    }
-
-    const auto wr_start = data.begin() + start;
-    const auto wr_end = wr_start + length;
-
-    if ( rhs.compressed ) {
-        for ( auto wr = wr_start; wr < wr_end; wr ++ )
-            *wr /= rhs.comp;
-    } else {
-        const auto rd_start = rhs.data.cbegin() + rhs_start;
-
-        auto wr = wr_start;
-        auto rd = rd_start;
-        for ( ; wr < wr_end; wr ++, rd ++ )
-            *wr /= *rd;
-    }
+    apply_all( *this, KernelOp::DIVIDE, start, rhs, rhs_start, length );
 }
 
 void Sequence::divide( AttrType attr, AttrType rhs_attr, int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
@@ -766,35 +1391,7 @@ void Sequence::divide( AttrType attr, AttrType rhs_attr, int64_t start, const Se
 template <auto M1, auto M2>
 void Sequence::divide_attr( int64_t start, const Sequence& rhs, int64_t rhs_start, int64_t length )
 {
-    typedef member_t<decltype(M1)> M1_t;
-
-    M1_t m_comp = (M1_t )(rhs.comp.*M2);
-    if ( rhs.compressed && m_comp == 1 )
-        return;
-    
-    if ( compressed ) {
-        if ( rhs.compressed && size == length ) {
-            comp.*M1 /= m_comp;
-            return;
-        }
-        
-        expand();
-    }
-
-    const auto wr_start = data.begin() + start;
-    const auto wr_end = wr_start + length;
-
-    if ( rhs.compressed ) {
-        for ( auto wr = wr_start; wr < wr_end; wr ++ )
-            (*wr).*M1 /= m_comp;
-    } else {
-        const auto rd_start = rhs.data.cbegin() + rhs_start;
-
-        auto wr = wr_start;
-        auto rd = rd_start;
-        for ( ; wr < wr_end; wr ++, rd ++ )
-            (*wr).*M1 /= (M1_t )((*rd).*M2);
-    }
+    apply_attr<M1, M2>( *this, KernelOp::DIVIDE, start, rhs, rhs_start, length );
 }
 
 void Sequence::divide_value( AttrType attr, int64_t start, int64_t length, int64_t value )
@@ -811,37 +1408,64 @@ void Sequence::divide_value_attr( int64_t start, int64_t length, int64_t value )
     if ( m_value == 1 )
         return;
 
-    if ( compressed ) {
-        if ( size == length ) {
-            comp.*M /= m_value;
-            return;
-        }
-        
-        expand();
-    }
-
-    const auto wr_start = data.begin() + start;
-    const auto wr_end = wr_start + length;
-
-    for ( auto wr = wr_start; wr < wr_end; wr ++ )
-        (*wr).*M /= m_value;
+    apply_value<M>( *this, KernelOp::DIVIDE, start, length, m_value );
 }
 
 
 void Sequence::print()
 {
+    flush();
     std::cout << "Seq: " << std::hex << this << "\n";
-    if ( compressed ) {
-        std::cout << "[ " << (int )comp.pitch << ", " << (int )comp.vel
-            << ", " << comp.dur << ", " << comp.wait << " ] x " << size << "\n";
-        return;
-    }
+    for ( const Piece& p : pieces ) {
+        if ( p.is_span() ) {
+            for ( int64_t i = 0; i < p.count; i ++ ) {
+                const Elem e = elem_at( p, i );
+                std::cout << "[ " << (int )e.pitch << ", " << (int )e.vel
+                    << ", " << e.dur << ", " << e.wait << " ]\n";
+            }
+            continue;
+        }
 
-    for ( Sequence::Elem& e : data )
-        std::cout << "[ " << (int )e.pitch << ", " << (int )e.vel
-            << ", " << e.dur << ", " << e.wait << " ]\n";
+        std::cout << "[ " << (int )p.elem.pitch << ", " << (int )p.elem.vel
+            << ", " << p.elem.dur << ", " << p.elem.wait << " ] x " << p.count
+            << " + [ " << (int )p.step.pitch << ", " << (int )p.step.vel
+            << ", " << p.step.dur << ", " << p.step.wait << " ]\n";
+    }
 }
 
+
+// explicit instantiations bound directly by ops whose attrs are known at build time (see operations.cpp)
+#define MDDL_INSTANTIATE_ONE_ATTR_FN( attr_fn, ... ) \
+    template void Sequence::attr_fn<&Elem::pitch>( __VA_ARGS__ ); \
+    template void Sequence::attr_fn<&Elem::vel>( __VA_ARGS__ ); \
+    template void Sequence::attr_fn<&Elem::dur>( __VA_ARGS__ ); \
+    template void Sequence::attr_fn<&Elem::wait>( __VA_ARGS__ );
+
+#define MDDL_INSTANTIATE_TWO_ATTR_FN_ROW( attr_fn, lhs_m, ... ) \
+    template void Sequence::attr_fn<lhs_m, &Elem::pitch>( __VA_ARGS__ ); \
+    template void Sequence::attr_fn<lhs_m, &Elem::vel>( __VA_ARGS__ ); \
+    template void Sequence::attr_fn<lhs_m, &Elem::dur>( __VA_ARGS__ ); \
+    template void Sequence::attr_fn<lhs_m, &Elem::wait>( __VA_ARGS__ );
+
+#define MDDL_INSTANTIATE_TWO_ATTR_FN( attr_fn, ... ) \
+    MDDL_INSTANTIATE_TWO_ATTR_FN_ROW( attr_fn, &Elem::pitch, __VA_ARGS__ ) \
+    MDDL_INSTANTIATE_TWO_ATTR_FN_ROW( attr_fn, &Elem::vel, __VA_ARGS__ ) \
+    MDDL_INSTANTIATE_TWO_ATTR_FN_ROW( attr_fn, &Elem::dur, __VA_ARGS__ ) \
+    MDDL_INSTANTIATE_TWO_ATTR_FN_ROW( attr_fn, &Elem::wait, __VA_ARGS__ )
+
+MDDL_INSTANTIATE_TWO_ATTR_FN( add_attr, int64_t, const Sequence&, int64_t, int64_t )
+MDDL_INSTANTIATE_TWO_ATTR_FN( subtract_attr, int64_t, const Sequence&, int64_t, int64_t )
+MDDL_INSTANTIATE_TWO_ATTR_FN( multiply_attr, int64_t, const Sequence&, int64_t, int64_t )
+MDDL_INSTANTIATE_TWO_ATTR_FN( divide_attr, int64_t, const Sequence&, int64_t, int64_t )
+
+MDDL_INSTANTIATE_ONE_ATTR_FN( add_value_attr, int64_t, int64_t, int64_t )
+MDDL_INSTANTIATE_ONE_ATTR_FN( subtract_value_attr, int64_t, int64_t, int64_t )
+MDDL_INSTANTIATE_ONE_ATTR_FN( multiply_value_attr, int64_t, int64_t, int64_t )
+MDDL_INSTANTIATE_ONE_ATTR_FN( divide_value_attr, int64_t, int64_t, int64_t )
+
 } // namespace MDDL
 
-#undef MDDL_DISAMBIGUATE_ATTR_FN
\ No newline at end of file
+#undef MDDL_DISAMBIGUATE_ATTR_FN
+#undef MDDL_INSTANTIATE_ONE_ATTR_FN
+#undef MDDL_INSTANTIATE_TWO_ATTR_FN_ROW
+#undef MDDL_INSTANTIATE_TWO_ATTR_FN
@@ -3,20 +3,26 @@
 #ifndef __MDDL_SEQUENCE_HPP__
 #define __MDDL_SEQUENCE_HPP__
 
+#include "pool.hpp"
+#include "small_vector.hpp"
+#include "stats.hpp"
 #include "utils.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <iostream>
 #include <list>
-#include <mutex>
+#include <memory>
 #include <type_traits>
 #include <vector>
 
 
 namespace MDDL {
 
+struct Recording;
+
 struct Sequence
 {
     struct Elem
@@ -33,31 +39,129 @@ struct Sequence
         void operator/=( const Elem& rhs );
     };
 
-    typedef std::vector<Elem> Data;
+    // columnar storage, one contiguous array per attribute
+    // so that single-attribute kernels only touch the column they modify
+    struct Data
+    {
+        Data() = default;
+        Data( const Data& rhs, int64_t rhs_start, int64_t rhs_length );
+
+        int64_t size() const { return (int64_t )pitch.size(); }
+        bool empty() const { return pitch.empty(); }
+
+        Elem get( int64_t idx ) const;
+        void push_back( const Elem& elem );
+        void resize( int64_t size );
+        void reserve( int64_t size );
+        void fill( int64_t start, int64_t length, const Elem& elem );
+        void copy( int64_t start, const Data& rhs, int64_t rhs_start, int64_t length );
+        void append( const Data& rhs, int64_t rhs_start, int64_t length );
+
+        template <auto M>
+        auto& column()
+        {
+            if constexpr ( same_member<M, &Elem::pitch>() ) return pitch;
+            else if constexpr ( same_member<M, &Elem::vel>() ) return vel;
+            else if constexpr ( same_member<M, &Elem::dur>() ) return dur;
+            else return wait;
+        }
+
+        template <auto M>
+        const auto& column() const
+        {
+            return const_cast<Data*>( this )->column<M>();
+        }
+
+        // accounted as payload, see MemStats
+        template <typename T>
+        using Column = std::vector<T, PayloadAllocator<T>>;
+
+        Column<uint8_t>     pitch   = {};
+        Column<uint8_t>     vel     = {};
+        Column<int32_t>     dur     = {};
+        Column<int32_t>     wait    = {};
+    };
+
+    // shared columnar storage, written in place only while a single piece holds it
+    typedef std::shared_ptr<Data> Chunk;
+
+    // a sequence is a list of pieces, each covering count elems from pos.
+    // run pieces progress from elem by step per attribute (zero step for constant runs),
+    // span pieces refer to the chunk elems from offset
+    struct Piece
+    {
+        Elem        elem        = {};
+        Elem        step        = {};
+        int64_t     count       = 0;
+        Chunk       chunk       = {};
+        int64_t     offset      = 0;
+        int64_t     pos         = 0;
+
+        bool is_span() const { return chunk != nullptr; }
+    };
+
+    // short sequences keep their elems as runs in the inline pieces, without any chunk
+    static constexpr size_t INLINE_PIECES = 2;
+    typedef SmallVector<Piece, INLINE_PIECES, PayloadAllocator<Piece>> Pieces;
+
+    // elem * mul + add per attribute, whole-sequence value ops are
+    // composed here and applied in one pass once the elems are read
+    struct Transform
+    {
+        Elem        mul         = { 1, 1, 1, 1 };
+        Elem        add         = {};
+        bool        active      = false;
+    };
+
+    // reads up to length elems from pos in order, without expanding them
+    struct Cursor
+    {
+        Cursor( const Sequence& seq, int64_t pos, int64_t length );
+
+        bool done() const { return left <= 0; }
+        Elem get() const;
+        void next();
+
+        const Sequence&     seq;
+        size_t              idx         = 0;
+        int64_t             offset      = 0;
+        int64_t             left        = 0;
+    };
 
     Sequence();
     Sequence( int64_t value );
     Sequence( const Elem& elem, int64_t size = 1 );
     Sequence( const Sequence& rhs, int64_t rhs_start, int64_t rhs_length );
+    ~Sequence();
+
+    // from the runtime's arena while it is enabled (see Runtime::promote), else the pool
+    static void* operator new( size_t size );
+    static void operator delete( void* p, size_t size );
 
-    void note_on( uint8_t pitch, uint8_t vel, int64_t wait );
-    void note_hold( int64_t idx, int64_t duration );
-    void mark_complete() { complete = true; }
+    void push_back( const Elem& elem );
+    void mark_complete();
+    bool recording() const { return !complete.load( std::memory_order_acquire ); }
+    void wait_complete() const;
+    void wait_recorded( int64_t n ) const;
+    void sync() { if ( rec != nullptr ) sync_recording(); }
+    void sync_recording();
 
     std::vector<Elem> get_data() const;
 
-    Elem& at( int64_t idx );
-    const Elem& at( int64_t idx ) const { return at( idx ); };
+    // content hash, cached only while interned (see intern)
+    uint64_t hash() const;
+    bool same_elems( const Sequence& rhs ) const;
+
+    Elem at( int64_t idx ) const;
 
     bool empty() const { return (size == 0); }
+    bool silent() const;
 
-    Elem& front() { return at( 0 ); }
-    const Elem& front() const { return at( 0 ); }
-    Elem& back() { return at( size - 1 ); }
-    const Elem& back() const { return at( size - 1 ); }
+    Elem front() const { return at( 0 ); }
+    Elem back() const { return at( size - 1 ); }
 
-    void expand();
-    std::vector<Elem> expanded() const;
+    void flush() const;
+    void settle();
     void resize( int64_t end );
     void expect( int64_t end );
     void crop( int64_t start, int64_t length );
@@ -125,14 +229,22 @@ struct Sequence
 
     void print();
 
-    Data        data        = {};
-    Elem        comp        = {};
-    int64_t     size        = 0;
-    int32_t     ref_count   = 0;
-    bool        compressed  = true;
-    bool        complete    = true;
-
-    std::mutex  mtx;
+    // sum of piece counts == size.
+    // flush() applies the pending transform on const reads, which leaves the value unchanged.
+    // pieces are only read and flushed on the exec thread, the scheduler takes copies of the notes
+    mutable Pieces      pieces      = {};
+    mutable Transform   pending     = {};
+    int64_t             size        = 0;
+
+    // refs may be taken and dropped on any thread.
+    // while a literal is recorded the parser only writes to rec,
+    // sync() takes the notes committed so far on the exec thread
+    Recording*          rec         = nullptr;
+    std::atomic<int32_t> ref_count  = 0;
+    std::atomic<bool>   complete    = true;
+
+    // 0 while not cached
+    uint64_t            hash_cache  = 0;
 };
 
 } // namepspace MDDL
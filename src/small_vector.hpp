@@ -0,0 +1,187 @@
+// small_vector.hpp
+// Vector that keeps its first N elems inline, heap allocating only beyond that
+
+#ifndef __MDDL_SMALL_VECTOR_HPP__
+#define __MDDL_SMALL_VECTOR_HPP__
+
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <utility>
+
+
+
+namespace MDDL {
+
+template <typename T, size_t N, typename Alloc = std::allocator<T>>
+class SmallVector
+{
+public:
+    SmallVector() = default;
+
+    SmallVector( std::initializer_list<T> init )
+    {
+        reserve( init.size() );
+        for ( const T& v : init )
+            push_back( v );
+    }
+
+    SmallVector( const SmallVector& rhs )
+    {
+        reserve( rhs.len );
+        for ( const T& v : rhs )
+            push_back( v );
+    }
+
+    SmallVector( SmallVector&& rhs )
+    {
+        take( rhs );
+    }
+
+    ~SmallVector()
+    {
+        clear();
+        release();
+    }
+
+    SmallVector& operator=( const SmallVector& rhs )
+    {
+        if ( this != &rhs ) {
+            clear();
+            reserve( rhs.len );
+            for ( const T& v : rhs )
+                push_back( v );
+        }
+
+        return *this;
+    }
+
+    SmallVector& operator=( SmallVector&& rhs )
+    {
+        if ( this != &rhs ) {
+            clear();
+            release();
+            take( rhs );
+        }
+
+        return *this;
+    }
+
+    size_t size() const { return len; }
+    size_t capacity() const { return cap; }
+    bool empty() const { return len == 0; }
+    bool is_inline() const { return ptr == inline_data(); }
+
+    T* data() { return ptr; }
+    const T* data() const { return ptr; }
+
+    T* begin() { return ptr; }
+    T* end() { return ptr + len; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + len; }
+    const T* cbegin() const { return ptr; }
+    const T* cend() const { return ptr + len; }
+
+    T& operator[]( size_t idx ) { return ptr[idx]; }
+    const T& operator[]( size_t idx ) const { return ptr[idx]; }
+
+    T& front() { return ptr[0]; }
+    T& back() { return ptr[len - 1]; }
+    const T& front() const { return ptr[0]; }
+    const T& back() const { return ptr[len - 1]; }
+
+    void reserve( size_t n )
+    {
+        if ( n > cap )
+            grow( n );
+    }
+
+    void push_back( const T& v )
+    {
+        if ( len == cap ) {
+            // v may be one of our elems
+            T tmp( v );
+            grow( cap * 2 );
+            new ( ptr + len ) T( std::move( tmp ) );
+        } else {
+            new ( ptr + len ) T( v );
+        }
+
+        len ++;
+    }
+
+    void pop_back()
+    {
+        ptr[-- len].~T();
+    }
+
+    void resize( size_t n )
+    {
+        while ( len > n )
+            pop_back();
+
+        reserve( n );
+        for ( ; len < n; len ++ )
+            new ( ptr + len ) T();
+    }
+
+    void clear()
+    {
+        while ( len > 0 )
+            pop_back();
+    }
+
+private:
+    T* inline_data() { return reinterpret_cast<T*>( buf ); }
+    const T* inline_data() const { return reinterpret_cast<const T*>( buf ); }
+
+    void grow( size_t n )
+    {
+        T* p = Alloc().allocate( n );
+        for ( size_t i = 0; i < len; i ++ ) {
+            new ( p + i ) T( std::move( ptr[i] ) );
+            ptr[i].~T();
+        }
+
+        release();
+        ptr = p;
+        cap = n;
+    }
+
+    void release()
+    {
+        if ( !is_inline() )
+            Alloc().deallocate( ptr, cap );
+
+        ptr = inline_data();
+        cap = N;
+    }
+
+    // rhs is left empty
+    void take( SmallVector& rhs )
+    {
+        if ( !rhs.is_inline() ) {
+            ptr = rhs.ptr;
+            cap = rhs.cap;
+            len = rhs.len;
+            rhs.ptr = rhs.inline_data();
+            rhs.cap = N;
+            rhs.len = 0;
+            return;
+        }
+
+        for ( ; len < rhs.len; len ++ )
+            new ( ptr + len ) T( std::move( rhs.ptr[len] ) );
+        rhs.clear();
+    }
+
+    alignas( T ) unsigned char buf[N * sizeof( T )];
+    T*          ptr         = inline_data();
+    size_t      len         = 0;
+    size_t      cap         = N;
+};
+
+} // namespace MDDL
+
+#endif // __MDDL_SMALL_VECTOR_HPP__
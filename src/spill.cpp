@@ -0,0 +1,71 @@
+// spill.cpp
+
+#include "errors.hpp"
+#include "spill.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <new>
+#include <string>
+#include <vector>
+
+
+
+namespace MDDL {
+
+std::atomic<size_t> spill_threshold = 64 * 1024 * 1024;
+std::filesystem::path spill_dir = {};
+
+#ifndef _WIN32
+
+void* spill_alloc( size_t size )
+{
+    std::error_code ec;
+    const std::filesystem::path dir = spill_dir.empty() ? std::filesystem::temp_directory_path( ec ) : spill_dir;
+
+    std::string name = (dir / "mddl-XXXXXX").string();
+    std::vector<char> templ( name.begin(), name.end() );
+    templ.push_back( '\0' );
+
+    const int fd = mkstemp( templ.data() );
+    rt_assert( fd >= 0, "Could not create spill file in " + dir.string() + "." );
+
+    // the mapping keeps the file alive, it is gone once unmapped
+    unlink( templ.data() );
+
+    void* p = MAP_FAILED;
+    if ( ftruncate( fd, (off_t )size ) == 0 )
+        p = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+    close( fd );
+    rt_assert( p != MAP_FAILED, "Could not map spill file." );
+
+    return p;
+}
+
+void spill_free( void* p, size_t size )
+{
+    if ( p != nullptr )
+        munmap( p, size );
+}
+
+#else
+
+// no spilling, blocks stay on the heap
+void* spill_alloc( size_t size )
+{
+    return ::operator new( size );
+}
+
+void spill_free( void* p, size_t )
+{
+    ::operator delete( p );
+}
+
+#endif
+
+} // namespace MDDL
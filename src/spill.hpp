@@ -0,0 +1,34 @@
+// spill.hpp
+// Storage for very large chunk columns, backed by a memory-mapped temp file
+// so that their pages can be written back and evicted instead of held resident.
+
+#ifndef __MDDL_SPILL_HPP__
+#define __MDDL_SPILL_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+
+
+namespace MDDL {
+
+// blocks of at least this many bytes are spilled, 0 to keep everything in memory.
+// set before execution, a block is freed by the rule it was allocated under
+extern std::atomic<size_t> spill_threshold;
+// temp files are created (and unlinked right away) here, the system temp dir if empty
+extern std::filesystem::path spill_dir;
+
+inline bool spills( size_t size )
+{
+    const size_t threshold = spill_threshold.load( std::memory_order_relaxed );
+    return threshold != 0 && size >= threshold;
+}
+
+void* spill_alloc( size_t size );
+void spill_free( void* p, size_t size );
+
+} // namespace MDDL
+
+#endif // __MDDL_SPILL_HPP__
@@ -0,0 +1,123 @@
+// stats.cpp
+
+#include "errors.hpp"
+#include "sequence.hpp"
+#include "stats.hpp"
+
+
+
+namespace MDDL {
+
+MemStats MemStats::global;
+thread_local MemStats* MemStats::scope = nullptr;
+std::atomic<int64_t> MemStats::limit = 0;
+
+static void raise_peak( std::atomic<int64_t>& peak, int64_t v )
+{
+    int64_t p = peak.load( std::memory_order_relaxed );
+    while ( v > p && !peak.compare_exchange_weak( p, v, std::memory_order_relaxed ) );
+}
+
+void MemStats::add_seq()
+{
+    note_seq( live_seqs.fetch_add( 1, std::memory_order_relaxed ) + 1 );
+}
+
+void MemStats::remove_seq()
+{
+    live_seqs.fetch_sub( 1, std::memory_order_relaxed );
+}
+
+void MemStats::add_bytes( int64_t n )
+{
+    note_bytes( n, bytes.fetch_add( n, std::memory_order_relaxed ) + n );
+}
+
+void MemStats::remove_bytes( int64_t n )
+{
+    bytes.fetch_sub( n, std::memory_order_relaxed );
+}
+
+void MemStats::note_seq( int64_t live )
+{
+    total_seqs.fetch_add( 1, std::memory_order_relaxed );
+    raise_peak( peak_seqs, live );
+}
+
+void MemStats::note_bytes( int64_t n, int64_t live )
+{
+    total_bytes.fetch_add( n, std::memory_order_relaxed );
+    raise_peak( peak_bytes, live );
+}
+
+int64_t MemStats::footprint() const
+{
+    return bytes.load( std::memory_order_relaxed )
+        + live_seqs.load( std::memory_order_relaxed ) * (int64_t )sizeof( Sequence );
+}
+
+void MemStats::print( std::ostream& os ) const
+{
+    os << "sequences: ";
+    if ( this == &global )
+        os << live_seqs << " live, ";
+    os << peak_seqs << " peak, " << total_seqs << " allocated\n";
+
+    os << "payload bytes: ";
+    if ( this == &global )
+        os << bytes << " live, ";
+    os << peak_bytes << " peak, " << total_bytes << " allocated\n";
+
+    os << "expansions: " << expansions << "\n";
+}
+
+static void check_limit( int64_t n )
+{
+    const int64_t cap = MemStats::limit.load( std::memory_order_relaxed );
+    rt_assert( cap == 0 || MemStats::global.footprint() + n <= cap, "Memory limit exceeded." );
+}
+
+void mem_charge_seq()
+{
+    check_limit( (int64_t )sizeof( Sequence ) );
+    MemStats::global.add_seq();
+    if ( MemStats::scope != nullptr )
+        MemStats::scope->note_seq( MemStats::global.live_seqs.load( std::memory_order_relaxed ) );
+}
+
+void mem_release_seq()
+{
+    MemStats::global.remove_seq();
+}
+
+static void count_bytes( size_t n )
+{
+    MemStats::global.add_bytes( (int64_t )n );
+    if ( MemStats::scope != nullptr )
+        MemStats::scope->note_bytes( (int64_t )n, MemStats::global.bytes.load( std::memory_order_relaxed ) );
+}
+
+void mem_charge_bytes( size_t n )
+{
+    check_limit( (int64_t )n );
+    count_bytes( n );
+}
+
+void mem_release_bytes( size_t n )
+{
+    MemStats::global.remove_bytes( (int64_t )n );
+}
+
+void mem_charge_recorded( size_t n )
+{
+    count_bytes( n );
+}
+
+void mem_charge_expansion()
+{
+    MemStats::global.expansions.fetch_add( 1, std::memory_order_relaxed );
+    if ( MemStats::scope != nullptr )
+        MemStats::scope->expansions.fetch_add( 1, std::memory_order_relaxed );
+}
+
+} // namespace MDDL
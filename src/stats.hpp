@@ -0,0 +1,118 @@
+// stats.hpp
+// Memory accounting of sequences, their chunk payloads, piece tables and recordings.
+// Live counts are kept for the whole process and checked against a configurable limit,
+// each scope counts what was allocated while it executed and the peaks it saw.
+
+#ifndef __MDDL_STATS_HPP__
+#define __MDDL_STATS_HPP__
+
+#include "pool.hpp"
+#include "spill.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+
+
+namespace MDDL {
+
+struct MemStats
+{
+    void add_seq();
+    void remove_seq();
+    void add_bytes( int64_t n );
+    void remove_bytes( int64_t n );
+
+    // scope counters, against the live counts of global
+    void note_seq( int64_t live );
+    void note_bytes( int64_t n, int64_t live );
+
+    int64_t footprint() const;
+
+    void print( std::ostream& os ) const;
+
+    std::atomic<int64_t>    live_seqs       = 0;
+    std::atomic<int64_t>    peak_seqs       = 0;
+    std::atomic<int64_t>    bytes           = 0;
+    std::atomic<int64_t>    peak_bytes      = 0;
+    std::atomic<int64_t>    total_seqs      = 0;
+    std::atomic<int64_t>    total_bytes     = 0;
+    std::atomic<int64_t>    expansions      = 0;
+
+    // whole process
+    static MemStats global;
+    // scope executed on this thread, charged alongside global (may be null)
+    static thread_local MemStats* scope;
+    // footprint cap in bytes, 0 for none
+    static std::atomic<int64_t> limit;
+};
+
+// sets the scope charged by this thread while in scope
+struct MemStatsScope
+{
+    MemStatsScope( MemStats* stats )
+        : prev  { MemStats::scope }
+    {
+        MemStats::scope = stats;
+    }
+
+    ~MemStatsScope() { MemStats::scope = prev; }
+
+    MemStats*   prev;
+};
+
+// raises a runtime error once the footprint would exceed the limit
+void mem_charge_seq();
+void mem_release_seq();
+void mem_charge_bytes( size_t n );
+void mem_release_bytes( size_t n );
+// counted past the limit, notes being recorded cannot be turned away
+void mem_charge_recorded( size_t n );
+void mem_charge_expansion();
+
+// pool allocator that accounts for the sequence payload it holds,
+// blocks past the spill threshold are file-backed instead
+template <typename T>
+struct PayloadAllocator
+{
+    typedef T value_type;
+
+    PayloadAllocator() = default;
+    template <typename U>
+    PayloadAllocator( const PayloadAllocator<U>& ) {}
+
+    T* allocate( size_t n )
+    {
+        mem_charge_bytes( n * sizeof( T ) );
+        try {
+            if ( spills( n * sizeof( T ) ) )
+                return (T* )spill_alloc( n * sizeof( T ) );
+
+            return (T* )pool_alloc( n * sizeof( T ) );
+        } catch ( ... ) {
+            mem_release_bytes( n * sizeof( T ) );
+            throw;
+        }
+    }
+
+    void deallocate( T* p, size_t n )
+    {
+        if ( spills( n * sizeof( T ) ) )
+            spill_free( p, n * sizeof( T ) );
+        else
+            pool_free( p, n * sizeof( T ) );
+
+        mem_release_bytes( n * sizeof( T ) );
+    }
+
+    template <typename U>
+    bool operator==( const PayloadAllocator<U>& ) const { return true; }
+    template <typename U>
+    bool operator!=( const PayloadAllocator<U>& ) const { return false; }
+};
+
+} // namespace MDDL
+
+#endif // __MDDL_STATS_HPP__
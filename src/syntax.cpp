@@ -531,37 +531,34 @@ void SyntaxParser::note_off( uint8_t note, int64_t tick )
 
 void SyntaxParser::sltx_note_on( uint8_t note, uint8_t vel, int64_t tick )
 {
-    Sequence& seq = sltx->ref.get();
-
-    std::lock_guard<std::mutex> guard( seq.mtx );
+    Recording& rec = *sltx->ref.get().rec;
 
     const double ns_to_ticks = 1.0 / 1'000'000'000.f / 60.f * tempo * ppq;
     const int64_t hold = (int64_t )((tick - prev_event_tick) * ns_to_ticks);
 
 
     for ( int64_t idx : sltx_held )
-        seq.note_hold( idx, hold );
+        rec.note_hold( idx, hold );
 
     if ( note == sltx->note && !sltx_forced ) {
         close_sltx();
         return;
     }
 
-    const int64_t wait = (seq.size == 0)
+    const int64_t wait = (rec.size() == 0)
         ? 0
         : (int64_t )((tick - prev_note_on_tick) * ns_to_ticks);
-    seq.note_on( note, vel, wait );
-    sltx_held.push_back( seq.size - 1 );
-    
+    rec.note_on( note, vel, wait );
+    sltx_held.push_back( rec.size() - 1 );
+    commit_sltx();
+
     prev_note_on_tick = tick;
     prev_event_tick = tick;
 }
 
 void SyntaxParser::sltx_note_off( uint8_t note, int64_t tick )
 {
-    Sequence& seq = sltx->ref.get();
-
-    std::lock_guard<std::mutex> guard( seq.mtx );
+    Recording& rec = *sltx->ref.get().rec;
 
     const double ns_to_ticks = 1.0 / 1'000'000'000.f / 60.f * tempo * ppq;
     const int64_t hold = (int64_t )((tick - prev_event_tick) * ns_to_ticks);
@@ -569,9 +566,9 @@ void SyntaxParser::sltx_note_off( uint8_t note, int64_t tick )
     auto itr = sltx_held.begin();
     while ( itr != sltx_held.end() ) {
         const int64_t idx = *itr;
-        seq.note_hold( idx, hold );
+        rec.note_hold( idx, hold );
 
-        if ( seq.at( idx ).pitch == note ) {
+        if ( rec.at( idx ).pitch == note ) {
             itr = sltx_held.erase( itr );
             continue;
         }
@@ -579,12 +576,22 @@ void SyntaxParser::sltx_note_off( uint8_t note, int64_t tick )
         itr ++;
     }
 
+    commit_sltx();
     prev_event_tick = tick;
 }
 
+// publishes the notes that are no longer held
+void SyntaxParser::commit_sltx()
+{
+    Recording& rec = *sltx->ref.get().rec;
+    rec.commit( sltx_held.empty() ? rec.size() : sltx_held.front() );
+}
+
 void SyntaxParser::close_sltx()
 {
-    sltx->ref.get().mark_complete();
+    Sequence& seq = sltx->ref.get();
+    seq.rec->close();
+    seq.mark_complete();
     clear();
 }
 
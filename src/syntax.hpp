@@ -5,6 +5,7 @@
 
 #include "data_ref.hpp"
 #include "expr.hpp"
+#include "recording.hpp"
 #include "utils.hpp"
 
 
@@ -151,6 +152,7 @@ public:
 private:
     void sltx_note_on( uint8_t note, uint8_t vel, int64_t tick );
     void sltx_note_off( uint8_t note, int64_t tick );
+    void commit_sltx();
 
     std::bitset<N_MIDI_NOTES>
                         notes_active        = {};
@@ -85,26 +85,34 @@ enum class AttrType : uint8_t
     ALL, PITCH, VELOCITY, DURATION, WAIT
 };
 
-// <from, to>
-// cast to wider type only
-static const std::map<DataType, DataType> implicit_cast_book = {
-    { DataType::SEQ_LIT, DataType::SEQ },
-    { DataType::SEQ, DataType::VSEQ },
-    { DataType::ATTR, DataType::VATTR }
-};
+static constexpr int N_DATA_TYPES = (int )DataType::ERROR + 1;
+static constexpr int N_ATTR_TYPES = (int )AttrType::WAIT + 1;
 
-inline bool has_implicit_cast( DataType type )
+constexpr bool is_attr_type( DataType type )
 {
-    return implicit_cast_book.contains( type );
+    return type == DataType::ATTR || type == DataType::VATTR;
 }
 
-inline DataType implicit_cast( DataType type )
+// cast to wider type only, UNKNOWN if there is none
+constexpr DataType implicit_cast( DataType type )
 {
-    return implicit_cast_book.at( type );
+    switch ( type ) {
+        case DataType::SEQ_LIT: return DataType::SEQ;
+        case DataType::SEQ: return DataType::VSEQ;
+        case DataType::ATTR: return DataType::VATTR;
+        default: break;
+    }
+
+    return DataType::UNKNOWN;
+}
+
+constexpr bool has_implicit_cast( DataType type )
+{
+    return implicit_cast( type ) != DataType::UNKNOWN;
 }
 
 // from, to
-inline bool may_implicit_cast( DataType a, DataType b )
+constexpr bool may_implicit_cast( DataType a, DataType b )
 {
     if ( a == b ) return true;
     while ( has_implicit_cast( a ) ) {
@@ -171,6 +179,16 @@ struct member_type {
 template <typename M>
 using member_t = member_type<M>::type;
 
+// compares member pointers of possibly different member types
+template <auto M1, auto M2>
+constexpr bool same_member()
+{
+    if constexpr ( std::is_same_v<decltype(M1), decltype(M2)> )
+        return M1 == M2;
+    else
+        return false;
+}
+
 }
 
 #endif // __MDDL_UTILS_HPP__
\ No newline at end of file
@@ -0,0 +1,26 @@
+# run_test.cmake
+# Runs one test program and compares what it prints with the expected output.
+#
+#   cmake -DMDDL=<mddl> -DPROGRAM=<name.mid> -DEXPECTED=<file> [-DARGS=<flag>] -P run_test.cmake
+#
+# CMake strings end at a NUL, so the programs must not print one.
+
+cmake_minimum_required(VERSION 3.22)
+
+execute_process(
+    COMMAND ${MDDL} ${ARGS} ${PROGRAM}
+    OUTPUT_VARIABLE OUTPUT
+    ERROR_VARIABLE OUTPUT
+    RESULT_VARIABLE RESULT
+    TIMEOUT 300
+)
+
+if (NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "mddl ${ARGS} exited with ${RESULT}\n${OUTPUT}")
+endif()
+
+file(READ ${EXPECTED} EXPECTED_OUTPUT)
+
+if (NOT OUTPUT STREQUAL EXPECTED_OUTPUT)
+    message(FATAL_ERROR "mddl ${ARGS} ${PROGRAM}\nexpected:\n${EXPECTED_OUTPUT}\nactual:\n${OUTPUT}")
+endif()
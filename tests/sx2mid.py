@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+# sx2mid.py
+# Writes the test programs, kept as s-expressions in *.sx, out as the
+# MIDI gestures the syntax parser reads (see syntax.cpp).
+#
+#   (DO x 5)                op on a bass note, operands played over it
+#   (PRINTD x)              IEF op, note 0 after an MDDL sysex
+#   (def f (a b) body...)   function def chord, args, body, def chord
+#   (call f x 1)            function call chord with its args
+#   (br id cond)            branch chord, the cond is compared
+#   x, 12, -3               variable melody, value literal
+#
+# usage: sx2mid.py file.sx... (writes file.mid next to each)
+
+import struct
+import sys
+
+OPS = { 'DO': 0, 'RE': 2, 'MI': 4, 'FA': 5, 'SO': 7, 'LA': 9, 'TI': 11 }
+IEFS = { 'PLAY': 0x21, 'NOTE_ON': 0x22, 'NOTE_OFF': 0x23, 'SLEEP': 0x24,
+         'PRINT': 0x25, 'PRINTD': 0x26, 'RECORDING': 0x27, 'RANDOM': 0x28, 'STATS': 0x29 }
+IEF_DEFAULT = 0x20
+MDDL_SYSEX_ID = 0x4d
+
+PPQ = 960
+STEP = 120
+
+# registers, each above the structure it is played over
+OP_NOTE = 48        # bass notes, an octave lower per nesting level
+CHORD_NOTE = 60     # function and branch chords
+SEPARATOR = 12      # below every split
+MELODY_NOTE = 72
+VALUE_NOTE = 96
+
+
+def tokenize( text ):
+    text = '\n'.join( line.split( ';' )[0] for line in text.splitlines() )
+    return text.replace( '(', ' ( ' ).replace( ')', ' ) ' ).split()
+
+
+def parse( tokens ):
+    stack = [[]]
+    for t in tokens:
+        if t == '(':
+            stack.append( [] )
+        elif t == ')':
+            node = stack.pop()
+            stack[-1].append( node )
+        else:
+            stack[-1].append( t )
+    return stack[0]
+
+
+class Writer:
+    def __init__( self ):
+        self.events = []
+        self.tick = 0
+        self.depth = 0
+        self.in_call = False
+        self.names = {}
+
+    def on( self, note ):
+        self.events.append( (self.tick, bytes( [0x90, note, 96] )) )
+        self.tick += STEP
+
+    def off( self, note ):
+        self.events.append( (self.tick, bytes( [0x80, note, 0] )) )
+        self.tick += STEP
+
+    def sysex( self, code ):
+        self.events.append( (self.tick, bytes( [0xf0, 3, MDDL_SYSEX_ID, code, 0xf7] )) )
+
+    def index( self, kind, name ):
+        key = (kind, name)
+        if key not in self.names:
+            self.names[key] = sum( 1 for k in self.names if k[0] == kind )
+        return self.names[key]
+
+    # three overlapping notes, a shorter melody reads as a chord at the root
+    def variable( self, name ):
+        i = self.index( 'var', name )
+        if i >= 36:
+            sys.exit( 'too many variables' )
+        m = [MELODY_NOTE, MELODY_NOTE + 1 + i % 6, MELODY_NOTE + 2 + i % 6 + i // 6]
+        self.on( m[0] )
+        self.on( m[1] )
+        self.off( m[0] )
+        self.on( m[2] )
+        self.off( m[1] )
+        self.off( m[2] )
+
+    # the digits are the intervals after the first note, a falling first one negates
+    def value( self, text ):
+        negative = text.startswith( '-' )
+        digits = [int( d ) for d in text.lstrip( '-' )]
+        note = VALUE_NOTE
+        self.on( note )
+        self.off( note )
+        for i, d in enumerate( digits ):
+            up = not negative if i == 0 else note + d <= VALUE_NOTE + 12
+            note = note + d if up else note - d
+            self.on( note )
+            self.off( note )
+
+    # a lone nested op would be heard as one more chord note
+    def chord( self, notes, children, root=False ):
+        if (root or len( notes ) > 1) and len( children ) == 1 and isinstance( children[0], list ):
+            sys.exit( 'lone op operand under a chord or root op, assign it first' )
+        for n in notes:
+            self.on( n )
+        self.operands( children )
+        for n in notes:
+            self.off( n )
+
+    def operands( self, children ):
+        prev_value = False
+        for child in children:
+            is_value = isinstance( child, str ) and (child[0].isdigit() or child[0] == '-')
+            if is_value and prev_value:
+                self.on( SEPARATOR )
+                self.off( SEPARATOR )
+            prev_value = is_value
+            self.expr( child )
+
+    def expr( self, node, root=False ):
+        if isinstance( node, str ):
+            if node[0].isdigit() or node[0] == '-':
+                self.value( node )
+            else:
+                self.variable( node )
+            return
+
+        head = node[0]
+        if head == 'call':
+            # chords share their notes, one cannot be held inside another
+            if self.in_call:
+                sys.exit( 'call nested in a call, assign it first' )
+            self.in_call = True
+            self.chord( self.fn_chord( node[1] ), node[2:] )
+            self.in_call = False
+        elif head in OPS:
+            note = OP_NOTE + OPS[head] - 12 * self.depth
+            if note <= SEPARATOR:
+                sys.exit( 'ops nested too deep' )
+            self.depth += 1
+            self.chord( [note], node[1:], root )
+            self.depth -= 1
+        elif head in IEFS:
+            self.chord( [0], node[1:], root )
+        else:
+            sys.exit( 'unknown op ' + head )
+
+    def fn_chord( self, name ):
+        i = self.index( 'fn', name )
+        return [CHORD_NOTE, CHORD_NOTE + 3 + i % 4, CHORD_NOTE + 7 + i // 4]
+
+    def branch_chord( self, name ):
+        i = self.index( 'br', name )
+        return [CHORD_NOTE, CHORD_NOTE + 1 + i]
+
+    def ief_of( self, node ):
+        if isinstance( node, str ):
+            return IEF_DEFAULT
+        if node[0] in IEFS:
+            return IEFS[node[0]]
+        for child in node[1:]:
+            code = self.ief_of( child )
+            if code != IEF_DEFAULT:
+                return code
+        return IEF_DEFAULT
+
+    def root( self, node ):
+        if node[0] == 'def':
+            notes = self.fn_chord( node[1] )
+            self.chord( notes, [] )
+            for arg in node[2]:
+                self.variable( arg )
+            self.chord( notes, [] )
+            for child in node[3:]:
+                self.root( child )
+            self.chord( notes, [] )
+            return
+
+        self.sysex( self.ief_of( node ) )
+        if isinstance( node, list ) and node[0] == 'br':
+            self.chord( self.branch_chord( node[1] ), node[2:] )
+        else:
+            self.expr( node, True )
+        self.tick += STEP
+
+    def smf( self ):
+        track = b''
+        last = 0
+        for tick, msg in self.events:
+            track += vlq( tick - last ) + msg
+            last = tick
+        track += vlq( 0 ) + b'\xff\x2f\x00'
+        head = b'MThd' + struct.pack( '>IHHH', 6, 0, 1, PPQ )
+        return head + b'MTrk' + struct.pack( '>I', len( track ) ) + track
+
+
+def vlq( n ):
+    out = [n & 0x7f]
+    n >>= 7
+    while n:
+        out.insert( 0, (n & 0x7f) | 0x80 )
+        n >>= 7
+    return bytes( out )
+
+
+for path in sys.argv[1:]:
+    w = Writer()
+    with open( path ) as f:
+        for node in parse( tokenize( f.read() ) ):
+            w.root( node )
+    with open( path[:-len( '.sx' )] + '.mid', 'wb' ) as f:
+        f.write( w.smf() )